@@ -32,8 +32,8 @@
 #define  INT_FLASH		0x00000000
 #define  INT_FLASH_REMAP	0x01000000
 
-#define  FLASH_PAGE_NB		512
-#define  FLASH_PAGE_SIZE	128
+#define  FLASH_PAGE_NB		1024
+#define  FLASH_PAGE_SIZE	256
 
 //------------------------  
 // Leds Definition   
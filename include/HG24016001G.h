@@ -63,6 +63,8 @@
 #define M_GRAY          (16<<3)
 #define D_GRAY          (24<<3)
 #define BLACK 		(31<<3)
+#define GRAY_LEVELS     32      // 32 gray-scale mode, shade<<3 in each byte
+#define GRAY_PARAMS     16      // PWM widths (0-31) taken by GRAY1 and GRAY2
 
 #define LCD_WIDTH       240
 #define LCD_HEIGHT      160
@@ -11,11 +11,14 @@
 #include "lcd.h"
 #include "HG24016001G.h"
 #include "timers.h"
+#include "zernike.h"
 
 #define APERTURE 32
+#define WAVELENGTH 64 // lines per wave in wavesLoop
 #define MAX_STEPS 32 // number of shades of grey
-#define DISPLAY_TIME 20000000
-#define TRANSITION_TIME 10000000
+#define DISPLAY_TIME (2*FRAME_RATE) // frames each pattern is shown
+#define TRANSITION_TIME FRAME_RATE // frames blank between patterns
+#define ZERNIKE_SWING (2*ZERNIKE_WAVE) // largest aberration in zernikeLoop
 
 
 // Waves moving down the display
@@ -27,3 +30,9 @@ void seesawLoop (void);
 // Gradually increasing gradient
 void slideLoop (void);
 
+// Turbulent phase screen extruded on the device
+void turbulenceLoop (void);
+
+// Defocus, astigmatism, coma and spherical aberration swung in turn
+void zernikeLoop (void);
+
@@ -0,0 +1,41 @@
+/*
+ * aperture.h
+ *
+ * The part of the panel the optics actually use. Renderers only stream the
+ * column groups inside it; pixels outside keep whatever they last showed.
+ *
+ * John Howe 2010
+ */
+
+#ifndef APERTURE_H
+#define APERTURE_H
+
+#include "config.h"
+#include "frame.h"
+#include "HG24016001G.h"
+
+/* The span of each row inside the aperture (span_t, frame.h), and the
+ * bands of rows that share a RAMWR window to stream it */
+extern span_t spans[LCD_HEIGHT];
+extern band_t bands[LCD_HEIGHT];
+extern uint8 bandCount;
+
+/* The whole panel, the default */
+void apertureFull (void);
+
+/* The inclusive rectangle of pixels x0-x1, y0-y1 */
+void apertureRect (uint8 x0, uint8 y0, uint8 x1, uint8 y1);
+
+/* The pixels whose centres are within radius pixels of (x, y) */
+void apertureCircle (uint8 x, uint8 y, uint8 radius);
+
+/* Column groups in the aperture, for comparison with LCD_WIDTH/3*LCD_HEIGHT */
+uint16 apertureGroups (void);
+
+/* Opens a window for each band and calls drawRow() for its rows in order,
+ * inside a burst. drawRow() must stream exactly endCol-startCol groups
+ * (3 bytes each) for row, starting at group startCol. Rows are display RAM
+ * lines, so the aperture only lines up with the panel when not scrolled. */
+void drawAperture (void (*drawRow)(uint8 row, uint8 startCol, uint8 endCol));
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * codec.h
+ *
+ * Compressed frame formats for the PC link
+ *
+ * John Howe 2010
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "config.h"
+#include "link.h"
+
+/* FORMAT_RLE and FORMAT_DELTA payloads are a stream of tokens covering the
+ * frame row by row; no token crosses the end of a row. Values are 5 bit
+ * shades (0-31), not LCD bytes.
+ *
+ *   0nnnnnnn v0 .. vn      literal: the next n+1 values
+ *   1nnnnnnn v             run: value v repeated n+1 times
+ *
+ * FORMAT_RLE values are the shades themselves. FORMAT_DELTA values are
+ * XORed with the frame on display, so unchanged pixels become long runs
+ * of 0. */
+#define CODEC_RUN       0x80
+#define CODEC_MAX       128     // values per token
+
+/* Prepare to decode a payload of the given format onto the LCD. The
+ * RAMWR window must already be open for the whole panel. */
+void startDecode (uint8 format);
+
+/* Decode part of a payload, writing pixels straight to the LCD bus and
+ * keeping the framebuffer (frame.h) as the reference for FORMAT_DELTA. */
+void decode (const uint8 *data, uint16 count);
+
+/* Record raw LCD bytes that were streamed to the panel directly, so the
+ * framebuffer keeps matching the display */
+void storePixels (const uint8 *pixels, uint16 count);
+
+/* Returns TRUE if exactly one frame has been decoded since startDecode() */
+uint8 decodeComplete (void);
+
+#endif
@@ -27,7 +27,7 @@ typedef struct {
 
 #define nop()  __asm__ __volatile__("nop")
 #define LED_A	(1U<<8)			// Status LED -  THIS IS ON PA6, SAME AS PD2!  - OOPS
-#define PANIC_RATE	10000000		// Delay time used in panic function
+#define PANIC_RATE	250000			// LED on and off time of each blink, in us (busyWait())
 
 #define bitRead(value, bit) (((value) >> (bit)) & 0x01)
 #define bitSet(value, bit) ((value) |= (1UL << (bit)))
@@ -35,10 +35,29 @@ typedef struct {
 #define bitWrite(value, bit, bitvalue) (bitvalue ? bitSet(value, bit) : bitClear(value, bit))
 #define bit(b) (1UL << (b))
 
+// Uncomment on a board with D0-D7 on PA6-PA13, to encode bytes for the bus
+// with a shift instead of table[] (see busWord() in lcd.h)
+//#define BUS_SHIFT 6
+
+// Uncomment to keep table[] in SRAM rather than flash, saving the flash
+// wait state on each command byte for 1K of SRAM
+//#define BUS_TABLE_RAM
+
 // Pin definitions
 #define PA0		AT91C_PIO_PA30
 #define PWR		AT91C_PIO_PA4
 #define PRD		AT91C_PIO_PA28
+#ifdef BUS_SHIFT
+// Board revisions with D0-D7 on consecutive lines from PA(BUS_SHIFT)
+#define PD0		((unsigned int) 1 << (BUS_SHIFT + 0))
+#define PD1		((unsigned int) 1 << (BUS_SHIFT + 1))
+#define PD2		((unsigned int) 1 << (BUS_SHIFT + 2))
+#define PD3		((unsigned int) 1 << (BUS_SHIFT + 3))
+#define PD4		((unsigned int) 1 << (BUS_SHIFT + 4))
+#define PD5		((unsigned int) 1 << (BUS_SHIFT + 5))
+#define PD6		((unsigned int) 1 << (BUS_SHIFT + 6))
+#define PD7		((unsigned int) 1 << (BUS_SHIFT + 7))
+#else
 #define PD0		AT91C_PIO_PA6
 #define PD1		AT91C_PIO_PA26
 #define PD2		AT91C_PIO_PA8
@@ -47,11 +66,31 @@ typedef struct {
 #define PD5		AT91C_PIO_PA22
 #define PD6		AT91C_PIO_PA12
 #define PD7		AT91C_PIO_PA20
+#endif
 #define PXCS	        AT91C_PIO_PA14
 #define PRST	        AT91C_PIO_PA21
+#define PUSBPUP         AT91C_PIO_PA16  // USB D+ pull-up, LOW to connect
 
 #define PD  PD0|PD1|PD2|PD3|PD4|PD5|PD6|PD7
 
+// Pins driven through PIO_ODSR by write(). XCS and RST are left out so they
+// keep their SODR/CODR state while a byte is clocked out.
+#define BUS_MASK (PA0|PWR|PRD|PD)
+
+// BUS_LEGACY (make BUS=legacy) falls back to the original SODR/CODR per-pin
+// write() for every byte, bursts included, to measure the PIO_ODSR bus
+// against.
+
+// Uncomment to time write(), setWindow(), slide() and the frames with TC1
+// (profile.h). A BUS_SPI build sends the figures out on the DBGU once a
+// second; the DBGU's DTXD (PA10) is PD4 on the parallel bus, so there they
+// are left in profiles[] for gdb.
+//#define PROFILE
+
+// BUS_SPI (make BUS=spi) drives the panel over its serial interface from
+// the SPI and PDC instead, see lcd.h. The pins above are then unused, bar
+// PRST, and PXCS's PA14 becomes SPCK.
+
 // Command locations
 #define CD0 0
 #define CD1 1
@@ -0,0 +1,54 @@
+/*
+ * displist.h
+ *
+ * Display lists: frames sent as drawing commands instead of pixels
+ *
+ * John Howe 2010
+ */
+
+#ifndef DISPLIST_H
+#define DISPLIST_H
+
+#include "config.h"
+#include "link.h"
+
+/* A FORMAT_LIST payload is a sequence of commands, each an opcode byte and
+ * its parameters. Columns are groups of three pixels (0-79) and rows are
+ * display RAM lines (0-159), both inclusive, as for setWindow(). Shades
+ * are 0-31. Anything not drawn keeps what it showed before.
+ *
+ *   LIST_FILL    c0 r0 c1 r1 shade    fill a rectangle
+ *   LIST_HRAMP   c0 r0 c1 r1 s0 s1    shade from s0 in column c0 to s1 in
+ *                                     column c1, the same on every row
+ *   LIST_VRAMP   c0 r0 c1 r1 s0 s1    shade from s0 on row r0 to s1 on r1
+ *   LIST_REPEAT  c0 r0 c1 r1          copy columns c0-c1 of row r0 down
+ *                                     to rows r0+1 to r1
+ *   LIST_BLIT    c0 r0 c1 r1 v ...    a rectangle of pixels, one shade per
+ *                                     pixel in RAMWR order
+ *   LIST_SCROLL  block                show block on the top line, as
+ *                                     scrollTo() */
+enum {
+    LIST_FILL = 1,
+    LIST_HRAMP,
+    LIST_VRAMP,
+    LIST_REPEAT,
+    LIST_BLIT,
+    LIST_SCROLL,
+    LIST_OPCODES
+};
+
+#define LIST_PARAMS     6       // parameters of the longest command
+
+/* Prepare to run a FORMAT_LIST payload */
+void startList (void);
+
+/* Run part of a payload. Drawing goes straight to the LCD with the burst
+ * paths in lcd.h and is mirrored into the framebuffer (frame.h), which
+ * stays the reference for FORMAT_DELTA. */
+void listData (const uint8 *data, uint16 count);
+
+/* The payload has ended. Returns TRUE if it ended between commands and
+ * every command was valid. */
+uint8 endList (void);
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * fixmath.h
+ *
+ * Fixed point maths for pattern generation, on tables generated on the
+ * build machine (tools/fixmath/mkfix, run by the Makefile into
+ * fixtables.c). Nothing here touches floating point.
+ *
+ * Angles and phases are turns in 16 bits: 65536 is a full turn, which is
+ * one wave, 2 pi, and 32 shades. A phase wraps for free in a uint16 and
+ * its shade is phase >> FIX_SHADE_SHIFT.
+ *
+ * John Howe 2010
+ */
+
+#ifndef FIXMATH_H
+#define FIXMATH_H
+
+#include "config.h"
+
+#define FIX_TURN        65536
+#define FIX_SHADE_SHIFT 11              // 16 bit phase to 5 bit shade
+#define FIX_ONE         32768           // 1.0 in Q15
+#define FIX_GAUSS_ONE   4096            // one standard deviation in Q12
+
+#define SIN_BITS        9
+#define SIN_ENTRIES     (1 << SIN_BITS) // per turn, plus one to interpolate to
+#define CORDIC_STEPS    18
+#define CORDIC_SHIFT    8               // extra bits kept in cordicAngles
+#define SQRT_ENTRIES    193             // sqrt of 64 to 256, see fixSqrt()
+#define GAUSS_BITS      9
+#define GAUSS_ENTRIES   (1 << GAUSS_BITS)
+#define GAUSS_LIMIT     4               // deviations the tails are cut at
+#define DITHER_BITS     3
+#define DITHER_SIZE     (1 << DITHER_BITS)
+
+/* Generated, see fixtables.c */
+extern const int16 sinTable[SIN_ENTRIES + 1];           // Q15
+extern const uint32 cordicAngles[CORDIC_STEPS];         // atan(2^-i), turns << CORDIC_SHIFT
+extern const uint16 sqrtTable[SQRT_ENTRIES];            // sqrt(64 + i) in Q11
+extern const int16 gaussTable[GAUSS_ENTRIES + 1];       // Q12
+extern const uint16 ditherTable[DITHER_SIZE][DITHER_SIZE]; // thresholds in turns
+
+/* sin and cos of a phase in Q15, by linear interpolation between the
+ * SIN_ENTRIES points of sinTable. Within 2 lsb. */
+static inline int16 fixSin (uint16 phase)
+{
+    uint16 i = phase >> (16 - SIN_BITS);
+    int32 frac = phase & ((1 << (16 - SIN_BITS)) - 1);
+    int32 a = sinTable[i], b = sinTable[i + 1];
+    return a + (((b - a) * frac) >> (16 - SIN_BITS));
+}
+
+static inline int16 fixCos (uint16 phase)
+{
+    return fixSin (phase + FIX_TURN/4);
+}
+
+/* Multiply a by a Q15 fraction, a up to +-2^16 */
+static inline int32 fixMul (int32 a, int16 q15)
+{
+    return (a * q15) >> 15;
+}
+
+/* The phase of (x, y) from the x axis by CORDIC, shifts and adds only.
+ * x and y up to +-2^23. Within 1 part in 65536 of a turn; 0 for (0, 0). */
+uint16 fixAtan2 (int32 y, int32 x);
+
+/* floor(sqrt(x)) exactly, from a table lookup and at most a couple of
+ * multiplies to correct it */
+uint16 fixSqrt (uint32 x);
+
+/* A gaussian deviate in Q12 from 16 uniform random bits, by the inverse
+ * normal distribution, cut at GAUSS_LIMIT deviations. Within 0.01
+ * deviations of the exact inverse for 98% of inputs, 0.02 further out. */
+int16 fixGauss (uint16 uniform);
+
+/* The shade (0-31) for a phase at pixel (x, y), ordered dithered so areas
+ * of a phase between two shades average out to it */
+static inline uint8 fixShade (uint16 phase, uint8 x, uint8 y)
+{
+    uint32 p = phase + ditherTable[y & (DITHER_SIZE-1)][x & (DITHER_SIZE-1)];
+    return (p >> FIX_SHADE_SHIFT) & 0x1F;
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * frame.h
+ *
+ * SRAM framebuffer with dirty tracking for the LCD
+ *
+ * John Howe 2010
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "config.h"
+#include "lcd.h"
+#include "HG24016001G.h"
+
+/* The panel is driven in 3 byte 3 pixel mode, so the buffer is kept in the
+ * same column groups. Each group packs three 5 bit shades into 16 bits:
+ * bits 14-10 left pixel, 9-5 middle pixel, 4-0 right pixel. 240x160 pixels
+ * then take 25600 bytes of the 64K SRAM. */
+#define FRAME_COLS      (LCD_WIDTH/3)
+
+/* A window costs 8 command bytes, about as much bus time as streaming 16
+ * data bytes, so rows are merged into one window while that wastes fewer
+ * than this many column groups. */
+#define WINDOW_GROUPS   5
+
+extern uint16 frame[LCD_HEIGHT][FRAME_COLS];
+
+/* Column groups startCol to endCol-1 of a row, endCol 0 for none: the
+ * changed part of a row here, the aperture in aperture.h */
+typedef struct {
+    uint8 startCol;
+    uint8 endCol;
+} span_t;
+
+/* Rows sharing one RAMWR window. Each band is streamed as rows of groups
+ * startCol to endCol-1, which covers the span of every row in it. */
+typedef struct {
+    uint8 startRow;
+    uint8 endRow;       // exclusive
+    uint8 startCol;
+    uint8 endCol;       // exclusive
+} band_t;
+
+/* Grows a band from row, whose span must not be empty: the rows below join
+ * it while the extra groups streamed by sharing the window cost less than
+ * opening another one. The next band starts at band->endRow or later. */
+void growBand (const span_t *spans, uint8 row, band_t *band);
+
+/* Fill the whole buffer with one shade (0-31) and mark it all dirty */
+void clearFrame (uint8 shade);
+
+/* Pixel access. x is 0-239, y is 0-159, shade is 0-31 */
+void setPixel (uint8 x, uint8 y, uint8 shade);
+uint8 getPixel (uint8 x, uint8 y);
+
+/* Fill an inclusive rectangle of pixels with one shade */
+void fillRect (uint8 x0, uint8 y0, uint8 x1, uint8 y1, uint8 shade);
+
+/* Mark column groups startCol..endCol of a row as changed, for callers that
+ * write into frame[][] directly */
+void markDirty (uint8 row, uint8 startCol, uint8 endCol);
+
+/* Send every changed region to the LCD and mark the buffer clean */
+void flushFrame (void);
+
+#endif
@@ -15,7 +15,8 @@
 #include "timers.h"
 
 // Endless loop of LED_A (PA0) blinks for error diagnosis.
-// Will blink code-many times and then make a longer delay.
+// Will blink code-many times and then make a longer delay. Timed with
+// busyWait(), so TC1 must be running (initTimers()).
 void PanicBlinker(uint8 code);
 // Hardware initialisation function.
 void InitController(void);
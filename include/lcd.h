@@ -18,6 +18,38 @@
 
 enum { DATA, COMMAND };
 
+/* Every store that drives the LCD bus goes through PIO_WRITE, so the host
+ * build can watch the bus (see host/st7529.c) */
+#ifndef PIO_WRITE
+#define PIO_WRITE(reg, value) ((reg) = (value))
+#endif
+
+/* The same for the SPI back-end */
+#ifndef SPI_WRITE
+#define SPI_WRITE(reg, value) ((reg) = (value))
+#endif
+
+#ifdef BUS_SPI
+/* Serial back-end (make BUS=spi, lcdspi.c): the panel strapped for its 9 bit
+ * serial interface, with SCL on SPCK (PA14), SDA on MOSI (PA13) and XCS on
+ * NPCS0 (PA11). Each byte goes out as one 9 bit word, A0 first. Pixels are
+ * gathered into SPI_CHUNK word buffers that the PDC sends while the CPU
+ * fills the other one. The parallel data pins are not used. */
+#define SPI_DIVIDER     3           // SPCK = MCK/3, 16MHz: check tSCYC for the supply,
+                                    // a whole panel takes 21.6ms (see lcdspi.c)
+#define SPI_DATA        0x100       // A0 in a 9 bit word
+#define SPI_CHUNK       LCD_WIDTH   // words per DMA buffer
+
+extern uint16 spiBuffer[2][SPI_CHUNK];
+extern uint16 *spiNext, *spiEnd; // the buffer being filled
+
+/* Queue the filled part of the buffer for the PDC, then wait for the other
+ * buffer to be sent so it can be filled next */
+void spiFlush (void);
+
+void initSPI (void);
+#endif
+
 
 
 enum { rising, falling };
@@ -30,22 +62,127 @@ enum { rising, falling };
 /* Init function taken from datasheet */
 void initLCD(void);
 
-/* Lookup to speed write() time */
-uint32* generateLookupTable (void);
-/* Manages table, creating it when it is first needed otherwise storing its
- * location */
-uint32* tableButler (void);
-
 /* Writes instruction or data to I/O ports connected to LCD. */
 void write(uint8 type, uint8 instruction);
 
+/* Burst data writes. beginBurst() drops chip select and selects DATA once,
+ * burstWrite() then only clocks each byte out with WR, and endBurst() raises
+ * chip select again. Use for RAMWR streams after prepDisplay(). No commands
+ * may be sent with write() between beginBurst() and endBurst(). */
+void beginBurst (void);
+void endBurst (void);
+
+/* The PIO_ODSR word putting a byte on D0-D7 for the first half of a bus
+ * cycle: data bits placed, A0 low, WR low, RD high. See BUS_MASK. With the
+ * data lines in order (BUS_SHIFT) that is a shift, otherwise a lookup in
+ * table[], which the compiler works out from the pin map. */
+#ifdef BUS_SHIFT
+static inline uint32 busWord (uint8 data)
+{
+    return ((uint32)data << BUS_SHIFT) | PRD;
+}
+#else
+#ifdef BUS_TABLE_RAM
+extern uint32 table[256];
+#else
+extern const uint32 table[256];
+#endif
+
+static inline uint32 busWord (uint8 data)
+{
+    return table[data];
+}
+#endif
+
+/* PIO_ODSR words for pixel bytes, with A0 set and the gray level passed
+ * through the calibration curve, so a pixel costs the same single lookup
+ * whatever the curve. All the burst writes below use it; write() keeps the
+ * uncalibrated busWord() for commands and their parameters. BUS_LEGACY
+ * keeps the calibrated byte instead, for write(). */
+extern uint32 pixelTable[256];
+
+/* Load a calibration curve: curve[level] is the gray code (0-31) the panel
+ * is sent for logical phase level (0-31). NULL restores the identity. Takes
+ * effect from the next pixel written, so load between frames. */
+void loadCalibration (const uint8 *curve);
+
+/* Streams count pixel bytes from a buffer (ideally in SRAM) inside a burst.
+ * Hand scheduled ARM kernel executing from RAM, see lcdstream.s; BUS_LEGACY
+ * has a loop of burstWrite() in lcd.c instead. */
+void streamPixels (const uint8 *pixels, uint16 count);
+
+/* Times streamPixels() from SRAM against the same kernel run from flash,
+ * into streamRate[] in bytes per second. Overwrites the panel. For gdb on
+ * the board ("streambench", tools/gdb/gdbinit); see lcdbench.c. Not for
+ * BUS_SPI or BUS_LEGACY. */
+enum { STREAM_RAM, STREAM_FLASH };
+extern uint32 streamRate[2];
+void measureStream (void);
+
+/* Clocks the same byte out count times inside a burst, driving the data
+ * pins only once. Also in lcdstream.s; for BUS_LEGACY it is count write()s
+ * in lcd.c. */
+void burstFill (uint8 data, uint16 count);
+
+static inline void burstWrite (uint8 data)
+{
+#ifdef BUS_SPI
+    *spiNext++ = pixelTable[data];
+    if (spiNext == spiEnd)
+        spiFlush ();
+#else
+#ifdef BUS_LEGACY
+    // The original bus: every byte a whole write(), chip select and all
+    write (DATA, pixelTable[data]);
+#else
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    uint32 out = pixelTable[data];
+    PIO_WRITE (pPIO->PIO_ODSR, out);
+    PIO_WRITE (pPIO->PIO_ODSR, out ^ (PWR | PRD));
+#endif
+#endif
+}
+
 
+void setWindow (uint8 startCol, uint8 startRow, uint8 endCol, uint8 endRow);
 uint16 prepDisplay (uint8 startC, uint8 startR, uint8 endC, uint8 endR);
 void eraseDisplay (void);
 
 
+/* Hardware scrolling moves in blocks of 4 lines */
+#define SCROLL_BLOCK    4
+#define SCROLL_BLOCKS   (LCD_HEIGHT/SCROLL_BLOCK)
+
+void initScroll (void);
+void scrollTo (uint8 block);
+
 void displayOff (void);
 void displayOn (void);
 
 
+/* Gray PWM tables: the controller makes its gray levels by pulse width
+ * modulation over two alternating frames, with the widths set by GRAY1
+ * and GRAY2. Loading widths measured for the modulator linearises the
+ * phase response in the controller, with no work per pixel. Tables are
+ * kept in GRAY_SLOTS slots so switching (e.g. per wavelength) is only the
+ * 36 command bytes, a few microseconds. Send between frames, not inside a
+ * burst. */
+#define GRAY_SLOTS      4
+
+typedef struct {
+    uint8 frame1[GRAY_PARAMS];  // GRAY1 parameters
+    uint8 frame2[GRAY_PARAMS];  // GRAY2 parameters
+} grayPWM_t;
+
+/* Send a table to the controller now */
+void setGrayPWM (const grayPWM_t *pwm);
+
+/* Keep a table in a slot for selectGrayPWM() */
+void storeGrayPWM (uint8 slot, const grayPWM_t *pwm);
+
+/* Send the table in slot to the controller; initLCD() sends it again after
+ * the software reset. Returns FALSE if the slot is empty. */
+uint8 selectGrayPWM (uint8 slot);
+
+
 #endif
@@ -0,0 +1,61 @@
+/*
+ * link.h
+ *
+ * Frame protocol between the PC and the SLM
+ *
+ * John Howe 2010
+ */
+
+#ifndef LINK_H
+#define LINK_H
+
+#include "config.h"
+#include "HG24016001G.h"
+
+/* Every frame is sent as a 6 byte header followed by its payload:
+ *
+ *   0  LINK_SYNC0
+ *   1  LINK_SYNC1
+ *   2  format, one of FORMAT_*
+ *   3  sequence number, incremented (mod 256) for every frame sent
+ *   4  payload length, low byte
+ *   5  payload length, high byte
+ */
+#define LINK_SYNC0      0xA5
+#define LINK_SYNC1      0x5A
+#define LINK_HEADER     6
+
+/* Payload formats */
+enum {
+    FORMAT_RAW = 0,     // LCD_WIDTH*LCD_HEIGHT bytes in RAMWR order, shade<<3
+    FORMAT_RLE,         // run length coded shades, see codec.h
+    FORMAT_DELTA,       // run length coded XOR with the previous frame
+    FORMAT_LIST,        // drawing commands, see displist.h
+    FORMATS,            // number of frame formats
+
+    FORMAT_PAGE = 0x10, // not a frame: a page of the sequence store, seqstore.h
+    FORMAT_CALIBRATION, // not a frame: GRAY_LEVELS bytes for loadCalibration()
+    FORMAT_GRAY         // not a frame: a gray PWM slot (lcd.h) to select, then
+                        // optionally the grayPWM_t to store in it first
+};
+
+#define FRAME_BYTES     (LCD_WIDTH*LCD_HEIGHT)
+
+typedef struct {
+    uint32 frames;      // frames displayed
+    uint32 dropped;     // frames missing from the sequence numbers
+    uint32 errors;      // frames skipped for a bad format or length
+    uint32 pages;       // store pages programmed
+} linkStats_t;
+
+extern linkStats_t linkStats;
+
+/* Feeds bytes received from the PC into the protocol. Payloads are decoded
+ * straight onto the LCD bus as they arrive, so any chunk size will do. */
+void parseLink (const uint8 *data, uint16 count);
+
+/* Forget any partial frame and the sequence number, so the next frame
+ * starts a new sequence */
+void resetLink (void);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * profile.h
+ *
+ * Cycle profiler. PROFILE_BEGIN() and PROFILE_END() around a piece of code
+ * add the MCK cycles it took (cycleCount(), TC1) to one of the points
+ * below, kept as a count, min, mean and max and a histogram with a bin for
+ * each power of two. nextFrame() times the frames themselves: from handing
+ * over one frame to handing over the next, sleeping included.
+ *
+ * With BUS_SPI, every PROFILE_REPORT frames the table goes out as text on
+ * the telemetry channel (telemetry.h) and starts again, one line per point:
+ *
+ *   write n 1204 min 36 mean 41 max 118 bins 0 0 0 0 0 31 1170 3
+ *
+ * where the bins count the times of 0-1, 2-3, 4-7, 8-15... cycles, up to
+ * the last one used. Formatting a report takes a few thousand cycles, in
+ * the frame that ends the period.
+ *
+ * On the parallel bus DTXD is LCD D4, so nothing is sent: profiles[] adds
+ * up from boot or the last profileClear(), and is read with gdb
+ * ("profile", tools/gdb/gdbinit). The bins stop at 0xFFFF, the totals go
+ * on.
+ *
+ * The points are added to from the tick interrupt too (the write()s of
+ * scrollTo() in presentScroll()), so profileAdd() masks IRQs.
+ *
+ * Built in only with PROFILE defined (config.h); the macros are empty
+ * otherwise.
+ *
+ * John Howe 2010
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "config.h"
+#include "timers.h"
+
+enum { PROFILE_WRITE, PROFILE_WINDOW, PROFILE_SLIDE, PROFILE_FRAME, PROFILE_POINTS };
+
+#define PROFILE_BINS    24              // the last also takes anything longer
+#define PROFILE_REPORT  FRAME_RATE      // frames between reports (BUS_SPI)
+
+typedef struct {
+    uint32 count;
+    uint32 min, max;
+    unsigned long long total;
+    uint16 bins[PROFILE_BINS];          // stop at 0xFFFF
+} profile_t;
+
+extern profile_t profiles[PROFILE_POINTS];
+extern const char *const profileNames[PROFILE_POINTS];
+
+/* Add one time in MCK cycles to a point */
+void profileAdd (uint8 point, uint32 cycles);
+
+/* The frame boundary, see nextFrame() */
+void profileFrame (void);
+
+/* Send the table to the telemetry channel, and clear it (BUS_SPI) */
+void profileReport (void);
+void profileClear (void);
+
+#ifdef PROFILE
+#define PROFILE_BEGIN()     uint32 profileStart = cycleCount ()
+#define PROFILE_END(point)  profileAdd ((point), cycleCount () - profileStart)
+#define PROFILE_FRAME()     profileFrame ()
+#else
+#define PROFILE_BEGIN()
+#define PROFILE_END(point)
+#define PROFILE_FRAME()
+#endif
+
+#endif
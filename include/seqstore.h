@@ -0,0 +1,78 @@
+/*
+ * seqstore.h
+ *
+ * Frame sequences stored in the flash above the firmware, played back
+ * without a PC attached
+ *
+ * John Howe 2010
+ */
+
+#ifndef SEQSTORE_H
+#define SEQSTORE_H
+
+#include "config.h"
+#include "link.h"
+
+/* The store takes the top 192K of the flash; the firmware must fit in the
+ * 64K below it (ld_flash.cmd). It is linked at the mirror of the flash at
+ * address 0, so a store image packed into main.bin by the linker is
+ * flashed with the firmware. */
+#define STORE_OFFSET    0x10000
+#define STORE_SIZE      0x30000
+#define STORE_PAGE      256         // AT91C_IFLASH_PAGE_SIZE
+#define STORE_PAGES     (STORE_SIZE/STORE_PAGE)
+#define STORE_MAGIC     0x534D4C53  // "SLMS"
+#define STORE_SEQUENCES 16
+
+/* TC0 cannot tick slower than this, slower sequences hold each frame for
+ * several ticks */
+#define STORE_MIN_RATE  23
+
+/* The store starts with a header of STORE_HEADER bytes, all fields
+ * little-endian:
+ *
+ *   0  STORE_MAGIC (4 bytes)
+ *   4  number of sequences (4 bytes)
+ *   8  STORE_SEQUENCES entries of STORE_ENTRY bytes:
+ *        0  offset of the first frame from the start of the store (4 bytes)
+ *        4  length of the frames in bytes (4 bytes)
+ *        8  number of frames (2 bytes)
+ *       10  ticks per second, STORE_MIN_RATE to 255
+ *       11  ticks each frame is shown, at least 1
+ *
+ * A sequence is its frames as link protocol frames (link.h), back to back,
+ * numbered from 0. The first frame must not be FORMAT_DELTA, as it follows
+ * the last frame of whatever was played before. A FORMAT_CALIBRATION frame
+ * may come first to play the sequence with its own curve; it takes no
+ * frame period. */
+#define STORE_ENTRY     12
+#define STORE_HEADER    (8 + STORE_SEQUENCES*STORE_ENTRY)
+
+#ifndef STORE_BASE
+extern const uint8 _seqstore[]; // ld_flash.cmd
+#define STORE_BASE      ((const uint8 *)_seqstore)
+#endif
+
+/* Returns the number of sequences in the store, 0 if there is no store */
+uint8 storeSequences (void);
+
+/* Play sequence index loops times (0 for ever) at its own frame rate,
+ * decoding each frame onto the LCD through parseLink(). Returns FALSE if
+ * there is no such sequence or a frame in it is damaged. */
+uint8 playSequence (uint8 index, uint16 loops);
+
+/* Play every sequence in the store in turn, for ever */
+void storeLoop (void);
+
+/* Program page (0 to STORE_PAGES-1) of the store with STORE_PAGE bytes.
+ * Runs from RAM with interrupts masked while the EFC is busy (about 6ms
+ * for the erase and write). Returns FALSE on a lock or programming error. */
+uint8 writeStorePage (uint16 page, const uint32 *data);
+
+/* FORMAT_PAGE payloads from the link: a little-endian page number then
+ * the STORE_PAGE bytes to program */
+void startPage (void);
+void pageData (const uint8 *data, uint16 count);
+uint8 endPage (void);
+
+#endif
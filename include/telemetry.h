@@ -0,0 +1,52 @@
+/*
+ * telemetry.h
+ *
+ * Text output on the DBGU (DTXD, PA10) that never waits. telemetry()
+ * copies into a ring in SRAM and returns at once, and the PDC sends the
+ * ring in the background. What does not fit in the ring is dropped and
+ * counted, so logging cannot hold up the pixel loop however slow the line.
+ *
+ * DTXD is LCD D4 on the parallel bus (config.h), so initTelemetry() only
+ * takes the pin with BUS_SPI or a pin map that leaves PA10 free, and
+ * otherwise leaves telemetry() counting what it drops. PROFILE, its user
+ * on the board, does not build without BUS_SPI (profile.h).
+ *
+ * Foreground only: telemetry() is not safe against itself from interrupts.
+ *
+ * John Howe 2010
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "config.h"
+
+#define TELEMETRY_SIZE  1024    // ring bytes, a power of two
+
+typedef struct {
+    uint32 sent;        // bytes the PDC has finished with
+    uint32 dropped;     // bytes that did not fit
+} telemetryStats_t;
+
+extern telemetryStats_t telemetryStats;
+
+/* The ring the PDC sends from */
+extern char telemetryRing[TELEMETRY_SIZE];
+
+/* Start the DBGU transmitter at AT91C_DBGU_BAUD, 8N1. Returns FALSE if
+ * DTXD is an LCD data line on this board. */
+uint8 initTelemetry (void);
+
+/* Queue length bytes. Returns how many fitted. */
+uint16 telemetry (const char *data, uint16 length);
+
+/* Queue a string, or a number in decimal */
+void telemetryText (const char *text);
+void telemetryNumber (uint32 value);
+
+/* Account for what the PDC has sent and hand it the next part of the
+ * ring. telemetry() does this itself; call it now and then as well when
+ * nothing is being logged, so a ring that has wrapped keeps going. */
+void pollTelemetry (void);
+
+#endif
@@ -9,11 +9,62 @@
 
 #include "config.h"
 #include "slimLib.h"
+#include "Board.h"
 
-void initTimers(void);
+#define TIMER_CLOCK     (MCK/32)    // TC0 counts at 1.4976 MHz
+#define CYCLE_CLOCK     (MCK/2)     // TC1 at 23.9616 MHz
+#define FRAME_RATE      50          // frames per second, at least 23 (TC0 is 16 bit)
+#define FRAME_PRIORITY  AT91C_AIC_PRIOR_HIGHEST
+
+typedef struct {
+    uint32 frames;      // frames presented on their tick
+    uint32 overruns;    // ticks missed because the frame was not ready
+} frameStats_t;
+
+extern volatile frameStats_t frameStats;
+extern volatile uint32 ticks; // frame periods since startFrames()
 
+/* Configure the timers and enable interrupts */
+void initTimers(void);
 
 /* Delay for a period of time in microseconds */
 void busyWait(uint32 delay);
 
+#ifdef PROFILE
+/* MCK cycles since initTimers(), to the nearest two; wraps every 89s.
+ * Reads right with IRQs masked for up to 1.3ms. Only built for the
+ * profiler, which pays for the TC1 overflow interrupt behind it. */
+uint32 cycleCount(void);
+#endif
+
+/* Mask IRQs around an update the tick interrupt also makes, returning the
+ * CPSR to hand to restoreIRQ(). No-ops in the host build (host/host.h). */
+#ifndef maskIRQ
+static inline uint32 maskIRQ(void) {
+    uint32 cpsr, masked;
+    __asm__ __volatile__(
+            "mrs %0, cpsr\n\t"
+            "orr %1, %0, #0x80\n\t"
+            "msr cpsr_c, %1" : "=r" (cpsr), "=r" (masked) : : "memory");
+    return cpsr;
+}
+
+static inline void restoreIRQ(uint32 cpsr) {
+    __asm__ __volatile__("msr cpsr_c, %0" : : "r" (cpsr) : "memory");
+}
+#endif
+
+/* Start the frame tick. present() is called from the tick interrupt for
+ * every frame handed over by nextFrame(), so it should be short (a scroll
+ * or display on/off command); NULL if nextFrame() returning is enough. */
+void startFrames(uint16 rate, void (*present)(void));
+void stopFrames(void);
+
+/* The next frame is ready: sleep until the tick presents it. A frame that
+ * arrives after its tick counts as an overrun and goes on the next one. */
+void nextFrame(void);
+
+/* Sleep for a number of frame periods */
+void waitFrames(uint32 count);
+
 #endif
@@ -0,0 +1,48 @@
+/*
+ * turbulence.h
+ *
+ * Infinite phase screens extruded on the device, one row at a time, by
+ * autoregression on the rows before it (Assemat et al. 2006):
+ *
+ *   new row = A * (previous AR_STENCIL values) + B * (gaussian noise)
+ *
+ * A and B come from the von Karman phase covariance and are generated at
+ * build time by tools/turbulence/mkar into arcoef.c, which lives in flash.
+ * Only the last AR_DEPTH rows are kept in SRAM.
+ *
+ * John Howe 2010
+ */
+
+#ifndef TURBULENCE_H
+#define TURBULENCE_H
+
+#include "config.h"
+#include "HG24016001G.h"
+
+#define AR_PIXEL        4                       // LCD pixels per phase sample, each way
+#define AR_COLS         (LCD_WIDTH/AR_PIXEL)    // samples per row
+#define AR_DEPTH        2                       // previous rows in the stencil
+#define AR_STENCIL      (AR_COLS*AR_DEPTH)
+#define AR_NOISE_STD    37837                   // standard deviation of arNoise()
+
+/* Phase is kept in 1/256ths of a shade, so the displayed shade is
+ * (phase >> 8) & 31 and the screen wraps every 2 pi */
+#define AR_SHADE(phase) (((phase) >> 8) & 0x1F)
+
+/* Generated by mkar, see arcoef.c */
+extern const int16 arA[AR_COLS][AR_STENCIL];       // Q(arAShift)
+extern const int16 arB[AR_COLS*(AR_COLS+1)/2];     // lower triangle by rows, Q(arBShift)
+extern const uint8 arAShift, arBShift;
+extern const uint16 arR0, arL0;                    // in samples
+
+/* Start a new screen from a seed. The first rows settle in from zero. */
+void startTurbulence (uint32 seed);
+
+/* Extrude the next row of phase into row[AR_COLS] */
+void nextTurbulence (int32 *row);
+
+/* Gaussian noise from the sum of four uniform 16 bit values, zero mean and
+ * AR_NOISE_STD deviation */
+int32 arNoise (void);
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * usart.h
+ *
+ * USART0 frame receiver using the Peripheral DMA Controller
+ *
+ * John Howe 2010
+ */
+
+#ifndef USART_H
+#define USART_H
+
+#include "config.h"
+#include "link.h"
+
+#define USART_BAUD      921600
+#define USART_CHUNK     512     // bytes per DMA buffer
+#define USART_TIMEOUT   20      // idle bit periods that end a burst of data
+
+/* Received data lands in two DMA buffers used alternately */
+extern uint8 usartBuffer[2][USART_CHUNK];
+
+/* Configure RXD0 (PA5) and start DMA reception. Only the receiver is used:
+ * TXD0 (PA6) is LCD data bit 0. */
+void initUSART (void);
+
+/* Passes every completed DMA buffer to parseLink(), plus the part filled
+ * so far once the line has gone idle, i.e. at the end of a frame. */
+void pollUSART (void);
+
+/* Display frames received on USART0 forever */
+void usartLoop (void);
+
+#endif
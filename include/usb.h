@@ -0,0 +1,37 @@
+/*
+ * usb.h
+ *
+ * USB CDC-ACM device on the UDP, receiving frames from the PC
+ *
+ * John Howe 2010
+ */
+
+#ifndef USB_H
+#define USB_H
+
+#include "config.h"
+#include "link.h"
+
+/* Endpoints, fixed by the UDP: EP0 control (8 bytes), EP1 and EP2 dual bank
+ * (64 bytes), EP3 single bank */
+#define EP_CONTROL      0
+#define EP_OUT          1
+#define EP_IN           2
+#define EP_NOTIFY       3
+#define EP_OUT_SIZE     64
+
+/* Enable the USB clocks and connect to the bus */
+void initUSB (void);
+
+/* Services enumeration and hands every received OUT bank to parseLink().
+ * Call as often as possible; both banks of EP_OUT fill while the previous
+ * one is being drawn. */
+void pollUSB (void);
+
+/* Returns TRUE once the host has configured the device */
+uint8 usbConfigured (void);
+
+/* Display frames received over USB forever */
+void usbLoop (void);
+
+#endif
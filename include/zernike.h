@@ -0,0 +1,69 @@
+/*
+ * zernike.h
+ *
+ * Aberration patterns: a weighted sum of the low order Zernike polynomials
+ * rasterised by forward differencing, so each pixel costs four additions
+ * and no multiplies, wrapped to the 32 shades and streamed to the bus.
+ *
+ * John Howe 2010
+ */
+
+#ifndef ZERNIKE_H
+#define ZERNIKE_H
+
+#include "config.h"
+#include "HG24016001G.h"
+
+/* The terms, in the order of the weights. These are the unnormalised
+ * polynomials in u, v on the unit pupil (u across, v down the panel,
+ * rho^2 = u^2 + v^2), so each peaks at about 1 on the pupil edge:
+ *
+ *   ZERNIKE_PISTON      1
+ *   ZERNIKE_TILT_X      u
+ *   ZERNIKE_TILT_Y      v
+ *   ZERNIKE_DEFOCUS     2 rho^2 - 1
+ *   ZERNIKE_ASTIG_0     u^2 - v^2
+ *   ZERNIKE_ASTIG_45    2 u v
+ *   ZERNIKE_COMA_X      (3 rho^2 - 2) u
+ *   ZERNIKE_COMA_Y      (3 rho^2 - 2) v
+ *   ZERNIKE_SPHERICAL   6 rho^4 - 6 rho^2 + 1 */
+enum {
+    ZERNIKE_PISTON = 0,
+    ZERNIKE_TILT_X,
+    ZERNIKE_TILT_Y,
+    ZERNIKE_DEFOCUS,
+    ZERNIKE_ASTIG_0,
+    ZERNIKE_ASTIG_45,
+    ZERNIKE_COMA_X,
+    ZERNIKE_COMA_Y,
+    ZERNIKE_SPHERICAL,
+    ZERNIKE_TERMS
+};
+
+#define ZERNIKE_WAVE    256     // weight of one wave (32 shades)
+#define ZERNIKE_DEGREE  4       // highest power of u and v
+
+/* Phase is accumulated in 64 bits, in 2^-ZERNIKE_SHIFT waves. The ARM then
+ * finds the shade in the high word alone. */
+#define ZERNIKE_SHIFT   40
+#define ZERNIKE_SHADE(phase) (((phase) >> (ZERNIKE_SHIFT - 5)) & 0x1F)
+
+/* The pupil the polynomials are scaled to: centre pixel and radius in
+ * pixels. Defaults to a radius of LCD_HEIGHT/2 in the middle of the panel.
+ * Takes effect from the next setZernike(). */
+void setZernikePupil (uint8 x, uint8 y, uint8 radius);
+
+/* Set the weights (ZERNIKE_TERMS of them, ZERNIKE_WAVE to a wave) for the
+ * frames drawn from now on. Expands the sum into one polynomial and finds
+ * its forward differences, the only multiplies and divides involved, so
+ * call it once per frame at most. */
+void setZernike (const int16 *weights);
+
+/* Stream the pattern to the part of the panel inside the aperture
+ * (aperture.h). Not scrolled: set scrollTo(0) first. */
+void drawZernike (void);
+
+/* The phase at a pixel evaluated directly, to check drawZernike() against */
+long long zernikePhase (uint8 x, uint8 y);
+
+#endif
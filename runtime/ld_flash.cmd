@@ -113,12 +113,17 @@ ENTRY(_vec_reset)
 /* Specify the memory areas for AT91SAM7S64: */
 MEMORY 
 {
-	flash	: ORIGIN = 0,          LENGTH = 256K	/* FLASH EPROM		*/	
+	flash	: ORIGIN = 0,          LENGTH = 64K	/* FLASH EPROM		*/	
+	store	: ORIGIN = 0x00010000, LENGTH = 192K	/* sequence store (seqstore.h)	*/
 	ram	: ORIGIN = 0x00200000, LENGTH = 64K  	/* static RAM area	*/
 }
 
 /* Define a global symbol _stack_end (see analysis in annotation above): */
-_stack_end = 0x203FFC;           /* AT91SAM7S256 */
+_stack_end = 0x20FFFC;           /* AT91SAM7S256, top of the 64K of SRAM */
+
+/* What crt.s takes below _stack_end: the UND, ABT, FIQ, IRQ and SVC stacks
+ * (0x1A0 bytes) and at least 2K for the user/system stack main() runs on */
+_stack_size = 0x1A0 + 0x800;
 
 
 /* Now define the output sections. */
@@ -143,6 +148,15 @@ SECTIONS
             _edata = .;	     	/* define a global symbol marking the end of the .data section  */
     } >ram AT >flash        	/* put all the above into RAM (but load the LMA initializer copy into FLASH)  */
 
+    .ramfunc : ALIGN(4)		/* code that must run from RAM (no flash wait states)  */
+    {
+        _ramfunc = .;	    	/* create a global symbol marking the start of the .ramfunc section  */
+        *(.ramfunc)	    	/* all .ramfunc sections  */
+            . = ALIGN(4);
+            _eramfunc = .;	/* define a global symbol marking the end of the .ramfunc section  */
+    } >ram AT >flash        	/* copied from FLASH to RAM by crt.s, like .data  */
+    _ramfunc_load = LOADADDR(.ramfunc);	/* where the .ramfunc initializer copy lives in FLASH  */
+
     .bss :			/* collect all uninitialized .bss sections that go into RAM  */
     {
         _bss_start = .;	    	/* define a global symbol marking the start of the .bss section */
@@ -152,11 +166,22 @@ SECTIONS
     . = ALIGN(4);		/* advance location counter to the next 32-bit boundary */
     _bss_end = . ;	    	/* define a global symbol marking the end of the .bss section */
 
+    .seqstore :			/* frame sequences linked in by seqdata.s, at the top of FLASH  */
+    {
+        _seqstore = .;	    	/* define a global symbol marking the start of the store  */
+        KEEP (*(.seqstore))
+    } >store
+
     . = ALIGN(4);               /* Added to fix linker error */
     .eh_frame :                 /* see http://www.makingthings.com/forum/development/7589512 */
     {
         KEEP (*(.eh_frame))
     } > ram
+
+    /* .data, .ramfunc, .bss (the framebuffer and tables) and the stacks must
+     * all fit in the SRAM, or the stacks grow down into .bss */
+    ASSERT(ADDR(.eh_frame) + SIZEOF(.eh_frame) + _stack_size <= _stack_end + 4,
+           "SRAM overflow: .data, .ramfunc, .bss and the stacks do not fit")
 }
 _end = .;			/* define a global symbol marking the end of application RAM */
 	
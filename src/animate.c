@@ -6,57 +6,192 @@
  */
 
 
+#include <string.h>
 #include "animate.h"
+#include "turbulence.h"
+#include "aperture.h"
+#include "profile.h"
+
+#if AR_PIXEL != SCROLL_BLOCK
+#error turbulenceLoop() scrolls one row of phase per block
+#endif
 
 
 void slide (uint8 aperture, uint8 steps, uint8 front, uint8 direction);
 void drawWaves (uint8 wavelength, uint8 wavefront, uint8 direction);
 void shiftFront (colour_t *colour, uint8 steps);
+void drawTurbulence (uint32 seed);
+
+/* A gradient being drawn a row at a time, as slide() draws it */
+typedef struct {
+    colour_t colour;
+    uint8 steps;
+    uint16 length; // groups of 3 pixels per shade
+    uint16 left; // groups until the next shade
+} wave_t;
+
+/* A row of phase as one line of pixels, each sample AR_PIXEL wide */
+static void phaseLine (const int32 *row, uint8 *line)
+{
+    for (int i = 0; i < AR_COLS; i++)
+    {
+        memset (line, AR_SHADE (row[i])<<3, AR_PIXEL);
+        line += AR_PIXEL;
+    }
+}
+
+static void startWave (wave_t *wave, uint8 aperture, uint8 steps, uint8 direction);
+static void waveRow (wave_t *wave, uint8 *line);
+static void drawWave (wave_t *wave, uint16 groups, uint8 *line);
+static void skipWave (wave_t *wave, uint16 groups);
+static void slideRow (uint8 row, uint8 startCol, uint8 endCol);
+static void phaseRow (uint8 block, const int32 *row);
+static void phaseLine (const int32 *row, uint8 *line);
+
+// The block on the top line, and the lines for the block the last tick
+// scrolled to the bottom
+static uint8 scrollBlock;
+static uint8 scrollLines[SCROLL_BLOCK][LCD_WIDTH] __attribute__ ((aligned (4)));
+
+// The gradient slide() is drawing, and how many groups of the frame it has
+// been through
+static wave_t slideWave;
+static uint16 slideGroups;
+
+/* The frame tick of the scrolling loops: only the scroll command, so the
+ * interrupt stays short. The block that was on the top line goes to the
+ * bottom, where writeScrolled() gives it its new lines. */
+static void presentScroll (void)
+{
+    scrollBlock++;
+    if (scrollBlock == SCROLL_BLOCKS)
+    {
+        scrollBlock = 0;
+    }
+    scrollTo (scrollBlock);
+}
+
+/* Write scrollLines to the block now on the bottom line. Called as soon as
+ * nextFrame() returns, so the block shows its old lines only for the time
+ * it takes to wake up and write the new ones. */
+static void writeScrolled (void)
+{
+    uint8 block = scrollBlock ? scrollBlock-1 : SCROLL_BLOCKS-1;
+    uint8 line = block * SCROLL_BLOCK;
+
+    setWindow (0, line, LCD_WIDTH/3-1, line+SCROLL_BLOCK-1);
+    beginBurst ();
+    streamPixels (scrollLines[0], sizeof(scrollLines));
+    endBurst ();
+}
 
+/* The waves are drawn once and then moved with the controller's scroll
+ * start line. Each step only the block scrolling off the top is redrawn with
+ * the next lines of the wave, as it reappears at the bottom. The lines are
+ * made before each frame and written just after the tick has scrolled,
+ * one block per frame (presentScroll(), writeScrolled()). */
 void wavesLoop (void)
 {
-    uint16 front = 0;
-    uint16 wavelength = 64;
+    wave_t wave;
+    startWave (&wave, WAVELENGTH, 32, rising);
+
+    initScroll ();
+    scrollTo (0);
+    setWindow (0, 0, LCD_WIDTH/3-1, LCD_HEIGHT-1);
+    beginBurst ();
+    for (int row = 0; row < LCD_HEIGHT; row++)
+        waveRow (&wave, NULL);
+    endBurst ();
+
+    scrollBlock = 0;
+    startFrames (FRAME_RATE, presentScroll);
+    for(;;)
+    {
+        for (int row = 0; row < SCROLL_BLOCK; row++)
+            waveRow (&wave, scrollLines[row]);
+        nextFrame ();
+        writeScrolled ();
+    }
+}
+
+/* A never repeating turbulent phase screen rolling up the display, one new
+ * row of phase (one scroll block) extruded per frame. See turbulence.h. */
+void turbulenceLoop (void)
+{
+    int32 row[AR_COLS];
+
+    drawTurbulence (1);
+    scrollBlock = 0;
+    startFrames (FRAME_RATE, presentScroll);
     for(;;)
     {
-        drawWaves (wavelength, front, rising);
-        front++;
-        if (front == wavelength)
+        nextTurbulence (row);
+        for (int l = 0; l < SCROLL_BLOCK; l++)
+            phaseLine (row, scrollLines[l]);
+        nextFrame ();
+        writeScrolled ();
+    }
+}
+
+/* Each aberration in turn swung through +-ZERNIKE_SWING and back, redrawn
+ * every frame. See zernike.h. */
+void zernikeLoop (void)
+{
+    int16 weights[ZERNIKE_TERMS] = { 0 };
+
+    initScroll ();
+    scrollTo (0);
+    startFrames (FRAME_RATE, NULL);
+    for (;;)
+    {
+        for (uint8 term = ZERNIKE_DEFOCUS; term < ZERNIKE_TERMS; term++)
         {
-            front = 0;
+            // A triangle wave, 4*DISPLAY_TIME frames to a cycle
+            for (uint16 t = 0; t < 4*DISPLAY_TIME; t++)
+            {
+                int16 phase = t < DISPLAY_TIME ? t : t < 3*DISPLAY_TIME ?
+                        2*DISPLAY_TIME - t : t - 4*DISPLAY_TIME;
+                weights[term] = (int32)ZERNIKE_SWING * phase / DISPLAY_TIME;
+                setZernike (weights);
+                drawZernike ();
+                nextFrame ();
+            }
+            weights[term] = 0;
         }
     }
 }
 
 void seesawLoop(void)
 {
+    startFrames (FRAME_RATE, NULL);
     for (;;)
     {
         eraseDisplay ();
         drawWaves (APERTURE, 0, rising);
-        busyWait (10000000);
+        waitFrames (DISPLAY_TIME);
         eraseDisplay ();
         drawWaves (APERTURE, 0, falling);
-        busyWait (10000000);
+        waitFrames (DISPLAY_TIME);
     }
 }
 
 void slideLoop (void)
 {
     uint8 steps = 0; 
+    startFrames (FRAME_RATE, NULL);
     while (TRUE)
     {
         steps ++;
         slide (APERTURE, steps, 0, 0);
-        busyWait (DISPLAY_TIME);
+        waitFrames (DISPLAY_TIME);
         displayOff();
-        busyWait (TRANSITION_TIME);
+        waitFrames (TRANSITION_TIME);
         displayOn();
         if (steps == MAX_STEPS)
         {
             steps = 0;
             displayOff();
-            busyWait (5*DISPLAY_TIME);
+            waitFrames (5*DISPLAY_TIME);
             displayOn();
         }
     }
@@ -72,40 +207,122 @@ void slideLoop (void)
 // steps - number of colour levels per aperture
 // front - line number to start on
 // direction - increasing or decreasing gradient
+//
+// Only the optical aperture (aperture.h) is streamed. The gradient runs on
+// through the groups outside it, so what is drawn matches the full frame.
 void slide (uint8 aperture, uint8 steps, uint8 front, uint8 direction)
 {
-    colour_t colour;
-    colour.shade = WHITE>>3; // be careful with colours being <<3'd
-    colour.direction = direction;
-
-    uint16 pix = prepDisplay(1, 1, LCD_WIDTH, LCD_HEIGHT);
-
-    // For determining where to change colour
-    uint16 colourLength = aperture * (LCD_WIDTH/3) / steps;
-    uint16 shiftPx = pix - colourLength;
+    PROFILE_BEGIN ();
+    startWave (&slideWave, aperture, steps, direction);
 
     //TODO this should shift lines, not colours
     for (int i = 0; i < front; i++)
-        shiftFront (&colour, steps);
+        shiftFront (&slideWave.colour, steps);
+
+    slideGroups = 0;
+    drawAperture (slideRow);
+    PROFILE_END (PROFILE_SLIDE);
+}
+
+static void slideRow (uint8 row, uint8 startCol, uint8 endCol)
+{
+    uint16 start = row * (LCD_WIDTH/3) + startCol;
+    skipWave (&slideWave, start - slideGroups);
+    drawWave (&slideWave, endCol - startCol, NULL);
+    slideGroups = start + endCol - startCol;
+}
+
+void drawWaves (uint8 wavelength, uint8 wavefront, uint8 direction)
+{
+    // Legacy support ;)
+    slide (wavelength, 32, wavefront, direction);
+}
+
+/* Fills the display with a new phase screen, scrolled to block 0 */
+void drawTurbulence (uint32 seed)
+{
+    int32 row[AR_COLS];
+
+    startTurbulence (seed);
+    initScroll ();
+    scrollTo (0);
+    for (uint8 block = 0; block < SCROLL_BLOCKS; block++)
+    {
+        nextTurbulence (row);
+        phaseRow (block, row);
+    }
+}
+
+/* Draws a row of phase as display block 'block', each sample AR_PIXEL
+ * pixels square and wrapped to the 32 shades */
+static void phaseRow (uint8 block, const int32 *row)
+{
+    uint8 line = block * SCROLL_BLOCK;
+    setWindow (0, line, LCD_WIDTH/3-1, line+SCROLL_BLOCK-1);
+    beginBurst ();
+    for (int l = 0; l < SCROLL_BLOCK; l++)
+        for (int i = 0; i < AR_COLS; i++)
+            burstFill (AR_SHADE (row[i])<<3, AR_PIXEL);
+    endBurst ();
+}
+
+static void startWave (wave_t *wave, uint8 aperture, uint8 steps, uint8 direction)
+{
+    wave->colour.shade = WHITE>>3;
+    wave->colour.direction = direction;
+    wave->steps = steps;
+    wave->length = aperture * (LCD_WIDTH/3) / steps;
+    if (wave->length == 0)
+        wave->length = 1;
+    wave->left = wave->length;
+}
 
-    while (pix--)
+/* The next row of the gradient into line, or into an open burst if NULL */
+static void waveRow (wave_t *wave, uint8 *line)
+{
+    drawWave (wave, LCD_WIDTH/3, line);
+}
+
+/* The next groups of the gradient, as runs of one shade: into line, or
+ * streamed into an open burst if NULL */
+static void drawWave (wave_t *wave, uint16 groups, uint8 *line)
+{
+    while (groups)
     {
-        write (DATA, colour.shade<<3);
-        write (DATA, colour.shade<<3);
-        write (DATA, colour.shade<<3);
+        uint16 run = groups < wave->left ? groups : wave->left;
+        if (line)
+        {
+            memset (line, wave->colour.shade<<3, 3*run);
+            line += 3*run;
+        }
+        else
+            burstFill (wave->colour.shade<<3, 3*run);
+        groups -= run;
+        wave->left -= run;
 
-        if (pix == shiftPx) // shifts colour at each row
+        if (wave->left == 0)
         {
-            shiftFront (&colour, steps);
-            shiftPx -= colourLength;
+            shiftFront (&wave->colour, wave->steps);
+            wave->left = wave->length;
         }
     }
 }
 
-void drawWaves (uint8 wavelength, uint8 wavefront, uint8 direction)
+/* Moves the gradient on by groups without drawing them */
+static void skipWave (wave_t *wave, uint16 groups)
 {
-    // Legacy support ;)
-    slide (wavelength, 32, wavefront, direction);
+    while (groups)
+    {
+        uint16 run = groups < wave->left ? groups : wave->left;
+        groups -= run;
+        wave->left -= run;
+
+        if (wave->left == 0)
+        {
+            shiftFront (&wave->colour, wave->steps);
+            wave->left = wave->length;
+        }
+    }
 }
 
 void shiftFront (colour_t *colour, uint8 steps)
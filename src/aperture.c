@@ -0,0 +1,136 @@
+/*
+ * aperture.c
+ *
+ * Aperture span table and the RAMWR windows used to stream it, see
+ * aperture.h
+ *
+ * John Howe 2010
+ */
+
+#include "aperture.h"
+#include "lcd.h"
+#include "frame.h"
+
+span_t spans[LCD_HEIGHT] = {
+    [0 ... LCD_HEIGHT-1] = { 0, LCD_WIDTH/3 }
+};
+band_t bands[LCD_HEIGHT] = {
+    { 0, LCD_HEIGHT, 0, LCD_WIDTH/3 }
+};
+uint8 bandCount = 1;
+
+/* Groups the rows into bands with growBand(), as flushFrame() groups the
+ * dirty rows */
+static void makeBands (void)
+{
+    uint8 row = 0;
+
+    bandCount = 0;
+    while (row < LCD_HEIGHT)
+    {
+        if (spans[row].endCol == 0)
+        {
+            row++;
+            continue;
+        }
+        growBand (spans, row, &bands[bandCount]);
+        row = bands[bandCount++].endRow;
+    }
+}
+
+/* Sets the span of a row from its first and last pixel */
+static void setSpan (uint8 row, int16 x0, int16 x1)
+{
+    if (x0 < 0)
+        x0 = 0;
+    if (x1 > LCD_WIDTH-1)
+        x1 = LCD_WIDTH-1;
+    if (x0 > x1)
+    {
+        spans[row].startCol = 0;
+        spans[row].endCol = 0;
+        return;
+    }
+    spans[row].startCol = x0/3;
+    spans[row].endCol = x1/3 + 1;
+}
+
+void apertureFull (void)
+{
+    apertureRect (0, 0, LCD_WIDTH-1, LCD_HEIGHT-1);
+}
+
+void apertureRect (uint8 x0, uint8 y0, uint8 x1, uint8 y1)
+{
+    for (uint8 row = 0; row < LCD_HEIGHT; row++)
+    {
+        if (row >= y0 && row <= y1)
+            setSpan (row, x0, x1);
+        else
+            setSpan (row, 1, 0);
+    }
+    makeBands ();
+}
+
+/* Largest r with r*r <= n */
+static uint16 isqrt (uint32 n)
+{
+    uint32 root = 0;
+    uint32 bit = 1UL << 30;
+
+    while (bit > n)
+        bit >>= 2;
+    while (bit)
+    {
+        if (n >= root + bit)
+        {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+void apertureCircle (uint8 x, uint8 y, uint8 radius)
+{
+    // In half pixels, so pixel centres are at odd coordinates
+    int32 r2 = 4L*radius*radius;
+
+    for (uint8 row = 0; row < LCD_HEIGHT; row++)
+    {
+        int32 dy = 2*row + 1 - 2*y;
+        if (dy*dy > r2)
+        {
+            setSpan (row, 1, 0);
+            continue;
+        }
+        int16 w = isqrt (r2 - dy*dy); // half width, in half pixels
+        // Pixels whose centre 2x+1 lies in 2x-w .. 2x+w
+        setSpan (row, (2*x - w) / 2, (2*x + w - 1) / 2);
+    }
+    makeBands ();
+}
+
+uint16 apertureGroups (void)
+{
+    uint16 groups = 0;
+    for (uint8 row = 0; row < LCD_HEIGHT; row++)
+        groups += spans[row].endCol - spans[row].startCol;
+    return groups;
+}
+
+void drawAperture (void (*drawRow)(uint8 row, uint8 startCol, uint8 endCol))
+{
+    for (uint8 i = 0; i < bandCount; i++)
+    {
+        const band_t *band = &bands[i];
+        setWindow (band->startCol, band->startRow, band->endCol-1, band->endRow-1);
+        beginBurst ();
+        for (uint8 row = band->startRow; row < band->endRow; row++)
+            drawRow (row, band->startCol, band->endCol);
+        endBurst ();
+    }
+}
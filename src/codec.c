@@ -0,0 +1,136 @@
+/*
+ * codec.c
+ *
+ * Decoder for the compressed link formats in codec.h. Pixels go straight to
+ * the LCD bus as they are decoded; the only frame kept is the packed
+ * framebuffer, which doubles as the reference for XOR deltas.
+ *
+ * John Howe 2010
+ */
+
+#include "codec.h"
+#include "frame.h"
+#include "lcd.h"
+
+enum { TOKEN, LITERAL, RUN };
+
+static uint8 format;
+static uint8 state;
+static uint8 left; // values left in the current token
+
+// Position in the framebuffer
+static uint16 *group;
+static uint8 phase; // pixel within the group, 0-2
+static uint16 packed;
+static uint16 pixels; // pixels decoded
+
+static void rewindFrame (void)
+{
+    group = &frame[0][0];
+    phase = 0;
+    packed = 0;
+    pixels = 0;
+}
+
+/* Shade on display at the current position */
+static inline uint8 previous (void)
+{
+    return (*group >> (10 - 5*phase)) & 0x1F;
+}
+
+/* Display one pixel and keep it in the framebuffer */
+static inline void emit (uint8 shade)
+{
+    burstWrite (shade << 3);
+    packed = (packed << 5) | shade;
+    if (++phase == 3)
+    {
+        *group++ = packed;
+        phase = 0;
+        packed = 0;
+    }
+    pixels++;
+}
+
+static inline void value (uint8 v)
+{
+    if (pixels == FRAME_BYTES)
+        return; // overlong payload, ignore the excess
+    if (format == FORMAT_DELTA)
+        v ^= previous ();
+    emit (v & 0x1F);
+}
+
+/* A run of one shade: filled on the bus in one go, then packed */
+static void fill (uint8 shade, uint8 count)
+{
+    if (count > FRAME_BYTES - pixels)
+        count = FRAME_BYTES - pixels;
+    burstFill (shade << 3, count);
+    pixels += count;
+    while (count--)
+    {
+        packed = (packed << 5) | shade;
+        if (++phase == 3)
+        {
+            *group++ = packed;
+            phase = 0;
+            packed = 0;
+        }
+    }
+}
+
+void startDecode (uint8 f)
+{
+    format = f;
+    state = TOKEN;
+    rewindFrame ();
+}
+
+void decode (const uint8 *data, uint16 count)
+{
+    while (count--)
+    {
+        uint8 b = *data++;
+        switch (state)
+        {
+            case TOKEN:
+                left = (b & ~CODEC_RUN) + 1;
+                state = (b & CODEC_RUN) ? RUN : LITERAL;
+                break;
+            case LITERAL:
+                value (b);
+                if (--left == 0)
+                    state = TOKEN;
+                break;
+            case RUN:
+                if (format == FORMAT_RLE)
+                    fill (b & 0x1F, left);
+                else
+                    while (left--)
+                        value (b);
+                state = TOKEN;
+                break;
+        }
+    }
+}
+
+void storePixels (const uint8 *data, uint16 count)
+{
+    while (count-- && pixels < FRAME_BYTES)
+    {
+        packed = (packed << 5) | (*data++ >> 3);
+        if (++phase == 3)
+        {
+            *group++ = packed;
+            phase = 0;
+            packed = 0;
+        }
+        pixels++;
+    }
+}
+
+uint8 decodeComplete (void)
+{
+    return pixels == FRAME_BYTES && state == TOKEN;
+}
@@ -0,0 +1,278 @@
+/*
+ * displist.c
+ *
+ * Runs display lists (displist.h) received over the link. Every command
+ * opens one window and draws it with burstFill() runs where it can, so a
+ * list costs about as much bus time as the pixels it changes and almost
+ * no link time.
+ *
+ * John Howe 2010
+ */
+
+#include <string.h>
+#include "displist.h"
+#include "frame.h"
+#include "lcd.h"
+
+static const uint8 paramCount[LIST_OPCODES] = {
+    [LIST_FILL] = 5,
+    [LIST_HRAMP] = 6,
+    [LIST_VRAMP] = 6,
+    [LIST_REPEAT] = 4,
+    [LIST_BLIT] = 4,
+    [LIST_SCROLL] = 1,
+};
+
+static uint8 opcode; // command being received, 0 between commands
+static uint8 params[LIST_PARAMS];
+static uint8 received; // parameters received
+static uint8 bad; // an invalid command has been seen
+
+// LIST_BLIT pixels still to come, and where the next one goes
+static uint16 blitLeft;
+static uint8 blitX, blitY;
+
+static inline uint16 packShade (uint8 shade)
+{
+    return (shade << 10) | (shade << 5) | shade;
+}
+
+/* Shade i of n+1 steps from s0 to s1, rounded */
+static inline uint8 rampShade (uint8 s0, uint8 s1, uint8 i, uint8 n)
+{
+    if (n == 0)
+        return s0;
+    if (s1 >= s0)
+        return s0 + ((s1 - s0) * i + n/2) / n;
+    return s0 - ((s0 - s1) * i + n/2) / n;
+}
+
+/* Checks the rectangle in the first four parameters and opens a window
+ * on it. Returns FALSE if it is not on the panel. */
+static uint8 openRect (void)
+{
+    uint8 c0 = params[0], r0 = params[1], c1 = params[2], r1 = params[3];
+
+    if (c0 > c1 || r0 > r1 || c1 >= FRAME_COLS || r1 >= LCD_HEIGHT)
+        return FALSE;
+    setWindow (c0, r0, c1, r1);
+    beginBurst ();
+    return TRUE;
+}
+
+static void fill (void)
+{
+    uint8 c0 = params[0], r0 = params[1], c1 = params[2], r1 = params[3];
+    uint8 shade = params[4] & 0x1F;
+    uint16 packed = packShade (shade);
+
+    burstFill (shade << 3, 3 * (c1-c0+1) * (r1-r0+1));
+    endBurst ();
+    for (uint8 r = r0; r <= r1; r++)
+        for (uint8 c = c0; c <= c1; c++)
+            frame[r][c] = packed;
+}
+
+static void hramp (void)
+{
+    uint8 c0 = params[0], r0 = params[1], c1 = params[2], r1 = params[3];
+    uint8 s0 = params[4] & 0x1F, s1 = params[5] & 0x1F;
+
+    // Work the row out once in the framebuffer, then copy it
+    for (uint8 c = c0; c <= c1; c++)
+        frame[r0][c] = packShade (rampShade (s0, s1, c - c0, c1 - c0));
+    for (uint8 r = r0 + 1; r <= r1; r++)
+        memcpy (&frame[r][c0], &frame[r0][c0], (c1-c0+1) * sizeof(uint16));
+
+    for (uint8 r = r0; r <= r1; r++)
+    {
+        uint8 c = c0;
+        while (c <= c1)
+        {
+            uint16 packed = frame[r0][c];
+            uint8 run = 1;
+            while (c + run <= c1 && frame[r0][c + run] == packed)
+                run++;
+            burstFill ((packed & 0x1F) << 3, 3*run);
+            c += run;
+        }
+    }
+    endBurst ();
+}
+
+static void vramp (void)
+{
+    uint8 c0 = params[0], r0 = params[1], c1 = params[2], r1 = params[3];
+    uint8 s0 = params[4] & 0x1F, s1 = params[5] & 0x1F;
+
+    for (uint8 r = r0; r <= r1; r++)
+    {
+        uint8 shade = rampShade (s0, s1, r - r0, r1 - r0);
+        uint16 packed = packShade (shade);
+        burstFill (shade << 3, 3 * (c1-c0+1));
+        for (uint8 c = c0; c <= c1; c++)
+            frame[r][c] = packed;
+    }
+    endBurst ();
+}
+
+/* Sends the groups of a framebuffer row, as runs where groups repeat */
+static void sendGroups (const uint16 *group, uint8 count)
+{
+    while (count)
+    {
+        uint16 packed = *group;
+        uint8 run = 1;
+        while (run < count && group[run] == packed)
+            run++;
+        if (packed == packShade (packed & 0x1F))
+            burstFill ((packed & 0x1F) << 3, 3*run);
+        else
+        {
+            for (uint8 i = 0; i < run; i++)
+            {
+                burstWrite ((packed >> 7) & 0xF8);
+                burstWrite ((packed >> 2) & 0xF8);
+                burstWrite ((packed << 3) & 0xF8);
+            }
+        }
+        group += run;
+        count -= run;
+    }
+}
+
+static void repeat (void)
+{
+    uint8 c0 = params[0], r0 = params[1], c1 = params[2], r1 = params[3];
+
+    if (r0 == r1)
+        return; // nothing below to copy to
+    setWindow (c0, r0 + 1, c1, r1);
+    beginBurst ();
+    for (uint8 r = r0 + 1; r <= r1; r++)
+    {
+        memcpy (&frame[r][c0], &frame[r0][c0], (c1-c0+1) * sizeof(uint16));
+        sendGroups (&frame[r][c0], c1-c0+1);
+    }
+    endBurst ();
+}
+
+/* Streams LIST_BLIT pixels into the window opened for them */
+static uint16 blit (const uint8 *data, uint16 count)
+{
+    uint8 x0 = 3*params[0], x1 = 3*params[2] + 2;
+    uint16 n = count < blitLeft ? count : blitLeft;
+
+    for (uint16 i = 0; i < n; i++)
+    {
+        uint8 shade = data[i] & 0x1F;
+        uint8 col = blitX/3;
+        uint8 shift = 10 - 5*(blitX - 3*col);
+
+        burstWrite (shade << 3);
+        frame[blitY][col] = (frame[blitY][col] & ~(0x1F << shift)) | (shade << shift);
+        if (blitX++ == x1)
+        {
+            blitX = x0;
+            blitY++;
+        }
+    }
+    blitLeft -= n;
+    if (blitLeft == 0)
+        endBurst ();
+    return n;
+}
+
+/* Runs the command in opcode and params */
+static void run (void)
+{
+    switch (opcode)
+    {
+        case LIST_SCROLL:
+            if (params[0] >= SCROLL_BLOCKS)
+            {
+                bad = TRUE;
+                return;
+            }
+            initScroll ();
+            scrollTo (params[0]);
+            return;
+        case LIST_REPEAT:
+            if (params[0] > params[2] || params[1] > params[3] ||
+                    params[2] >= FRAME_COLS || params[3] >= LCD_HEIGHT)
+            {
+                bad = TRUE;
+                return;
+            }
+            repeat ();
+            return;
+    }
+
+    if (!openRect ())
+    {
+        bad = TRUE;
+        return;
+    }
+    switch (opcode)
+    {
+        case LIST_FILL:  fill (); break;
+        case LIST_HRAMP: hramp (); break;
+        case LIST_VRAMP: vramp (); break;
+        case LIST_BLIT:
+            blitX = 3*params[0];
+            blitY = params[1];
+            blitLeft = 3 * (params[2]-params[0]+1) * (params[3]-params[1]+1);
+            break;
+    }
+}
+
+void startList (void)
+{
+    opcode = 0;
+    received = 0;
+    bad = FALSE;
+    blitLeft = 0;
+}
+
+void listData (const uint8 *data, uint16 count)
+{
+    while (count)
+    {
+        if (blitLeft)
+        {
+            uint16 n = blit (data, count);
+            data += n;
+            count -= n;
+            continue;
+        }
+
+        uint8 b = *data++;
+        count--;
+        if (opcode == 0)
+        {
+            if (b == 0 || b >= LIST_OPCODES)
+                bad = TRUE;
+            else
+                opcode = b;
+            received = 0;
+            continue;
+        }
+        params[received++] = b;
+        if (received == paramCount[opcode])
+        {
+            run ();
+            opcode = 0;
+        }
+    }
+}
+
+uint8 endList (void)
+{
+    if (blitLeft)
+    {
+        endBurst ();
+        blitLeft = 0;
+        return FALSE;
+    }
+    return !bad && opcode == 0;
+}
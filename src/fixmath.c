@@ -0,0 +1,90 @@
+/*
+ * fixmath.c
+ *
+ * Fixed point maths on the generated tables, see fixmath.h
+ *
+ * John Howe 2010
+ */
+
+#include "fixmath.h"
+
+uint16 fixAtan2 (int32 y, int32 x)
+{
+    uint32 angle = 0;
+
+    if (x == 0 && y == 0)
+        return 0;
+
+    // Into the right half plane, then scaled up so the shifts keep bits
+    if (x < 0)
+    {
+        x = -x;
+        y = -y;
+        angle = (uint32)(FIX_TURN/2) << CORDIC_SHIFT;
+    }
+    uint32 m = x | (y < 0 ? -y : y);
+    uint8 shift = 0;
+    for (uint8 step = 16; step; step >>= 1)
+    {
+        if (m < (1UL << (23 - step)))
+        {
+            m <<= step;
+            shift += step;
+        }
+    }
+    x <<= shift;
+    y <<= shift;
+
+    // Rotate onto the x axis, adding up the angles turned through
+    for (uint8 i = 0; i < CORDIC_STEPS; i++)
+    {
+        int32 dx = x >> i, dy = y >> i;
+        if (y > 0)
+        {
+            x += dy;
+            y -= dx;
+            angle += cordicAngles[i];
+        }
+        else
+        {
+            x -= dy;
+            y += dx;
+            angle -= cordicAngles[i];
+        }
+    }
+    return (angle + (1 << (CORDIC_SHIFT - 1))) >> CORDIC_SHIFT;
+}
+
+uint16 fixSqrt (uint32 x)
+{
+    if (x == 0)
+        return 0;
+
+    // x << 2k has one of its top two bits set, so its top byte is 64-255
+    uint8 k = 0;
+    while ((x << 2*k) < 0x40000000)
+        k++;
+    uint32 n = x << 2*k;
+    uint8 i = (n >> 24) - 64;
+    uint32 frac = (n >> 16) & 0xFF;
+
+    // sqrt(n) = 2 sqrt(n >> 24) << 11, by interpolating the table
+    uint32 root = 2*sqrtTable[i] + (((sqrtTable[i+1] - sqrtTable[i]) * frac) >> 7);
+    root >>= k;
+
+    if (root > 0xFFFF)
+        root = 0xFFFF;
+    while (root * root > x)
+        root--;
+    while (root < 0xFFFF && (root + 1) * (root + 1) <= x)
+        root++;
+    return root;
+}
+
+int16 fixGauss (uint16 uniform)
+{
+    uint16 i = uniform >> (16 - GAUSS_BITS);
+    int32 frac = uniform & ((1 << (16 - GAUSS_BITS)) - 1);
+    int32 a = gaussTable[i], b = gaussTable[i + 1];
+    return a + (((b - a) * frac) >> (16 - GAUSS_BITS));
+}
@@ -0,0 +1,80 @@
+/*
+ * flash.c
+ *
+ * In-application programming of the sequence store through the embedded
+ * flash controller. The flash cannot be read while the EFC is writing it,
+ * so the routine runs from RAM (.ramfunc) and keeps interrupts, whose
+ * handlers are in flash, masked until the EFC is ready again.
+ *
+ * John Howe 2010
+ */
+
+#include "seqstore.h"
+
+#define EFC_KEY     (0x5AU << 24)
+
+/* MCK cycles in 1us, the FMCN for lock and NVM bit commands. Programming
+ * needs 1.5us, the 72 init.c sets. */
+#define FMCN_1US    48
+
+/* Mask IRQs, returning the old CPSR. Always inlined, as nothing may be
+ * called in flash while the EFC is busy. */
+static inline __attribute__ ((always_inline)) uint32 maskIRQ (void)
+{
+    uint32 cpsr, masked;
+    __asm__ __volatile__(
+            "mrs %0, cpsr\n\t"
+            "orr %1, %0, #0x80\n\t"
+            "msr cpsr_c, %1" : "=r" (cpsr), "=r" (masked) : : "memory");
+    return cpsr;
+}
+
+static inline __attribute__ ((always_inline)) void restoreIRQ (uint32 cpsr)
+{
+    __asm__ __volatile__("msr cpsr_c, %0" : : "r" (cpsr) : "memory");
+}
+
+/* Returns the status the command finished with. Reading MC_FSR clears the
+ * error bits, so it is read just once after the command is done. */
+static inline __attribute__ ((always_inline)) uint32 efcCommand (uint32 page, uint32 command)
+{
+    uint32 status;
+
+    AT91C_BASE_MC->MC_FCR = EFC_KEY | ((page << 8) & AT91C_MC_PAGEN) | command;
+    while (!((status = AT91C_BASE_MC->MC_FSR) & AT91C_MC_FRDY))
+        ;
+    return status;
+}
+
+uint8 __attribute__ ((section (".ramfunc"), noinline)) writeStorePage (uint16 page, const uint32 *data)
+{
+    uint32 number = STORE_OFFSET/STORE_PAGE + page; // page of the whole flash
+    volatile uint32 *latch = (volatile uint32 *)(AT91C_IFLASH + number*STORE_PAGE);
+    uint32 lock = AT91C_MC_LOCKS0 << (number*STORE_PAGE / AT91C_IFLASH_LOCK_REGION_SIZE);
+    uint32 status = 0;
+
+    if (page >= STORE_PAGES)
+        return FALSE;
+
+    uint32 cpsr = maskIRQ ();
+    while (!(AT91C_BASE_MC->MC_FSR & AT91C_MC_FRDY))
+        ;
+    if (AT91C_BASE_MC->MC_FSR & lock)
+    {
+        uint32 fmr = AT91C_BASE_MC->MC_FMR;
+
+        AT91C_BASE_MC->MC_FMR = (fmr & ~AT91C_MC_FMCN) | ((FMCN_1US << 16) & AT91C_MC_FMCN);
+        status = efcCommand (number, AT91C_MC_FCMD_UNLOCK);
+        AT91C_BASE_MC->MC_FMR = fmr;
+    }
+    if (!(status & AT91C_MC_LOCKE))
+    {
+        // Fill the page latch, then erase and program the page from it
+        for (uint16 i = 0; i < STORE_PAGE/4; i++)
+            latch[i] = data[i];
+        status = efcCommand (number, AT91C_MC_FCMD_START_PROG);
+    }
+    restoreIRQ (cpsr);
+
+    return !(status & (AT91C_MC_LOCKE | AT91C_MC_PROGE));
+}
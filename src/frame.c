@@ -0,0 +1,154 @@
+/*
+ * frame.c
+ *
+ * SRAM framebuffer with dirty tracking for the LCD. Drawing only touches the
+ * buffer; flushFrame() then sends the changed column span of each changed
+ * row, merging neighbouring rows into as few CASET/LASET windows as
+ * possible.
+ *
+ * John Howe 2010
+ */
+
+#include "frame.h"
+
+uint16 frame[LCD_HEIGHT][FRAME_COLS];
+
+// Changed column groups of each row; endCol == 0 means the row is unchanged
+static span_t dirty[LCD_HEIGHT];
+
+static inline uint16 packShade (uint8 shade)
+{
+    return (shade << 10) | (shade << 5) | shade;
+}
+
+static inline void putPixel (uint8 x, uint8 y, uint8 shade)
+{
+    uint8 col = x/3;
+    uint8 shift = 10 - 5*(x - 3*col);
+    frame[y][col] = (frame[y][col] & ~(0x1F << shift)) | ((shade & 0x1F) << shift);
+}
+
+void markDirty (uint8 row, uint8 startCol, uint8 endCol)
+{
+    if (dirty[row].endCol == 0)
+    {
+        dirty[row].startCol = startCol;
+        dirty[row].endCol = endCol+1;
+        return;
+    }
+    if (startCol < dirty[row].startCol)
+        dirty[row].startCol = startCol;
+    if (endCol >= dirty[row].endCol)
+        dirty[row].endCol = endCol+1;
+}
+
+void clearFrame (uint8 shade)
+{
+    uint16 packed = packShade (shade);
+    for (int row = 0; row < LCD_HEIGHT; row++)
+    {
+        for (int col = 0; col < FRAME_COLS; col++)
+            frame[row][col] = packed;
+        dirty[row].startCol = 0;
+        dirty[row].endCol = FRAME_COLS;
+    }
+}
+
+void setPixel (uint8 x, uint8 y, uint8 shade)
+{
+    putPixel (x, y, shade);
+    markDirty (y, x/3, x/3);
+}
+
+uint8 getPixel (uint8 x, uint8 y)
+{
+    uint8 col = x/3;
+    uint8 shift = 10 - 5*(x - 3*col);
+    return (frame[y][col] >> shift) & 0x1F;
+}
+
+void fillRect (uint8 x0, uint8 y0, uint8 x1, uint8 y1, uint8 shade)
+{
+    uint16 packed = packShade (shade);
+    for (uint16 y = y0; y <= y1; y++)
+    {
+        // Whole groups are written in one go, partial ones a pixel at a time
+        uint16 x = x0;
+        while (x <= x1)
+        {
+            if (x % 3 == 0 && x+2 <= x1)
+            {
+                frame[y][x/3] = packed;
+                x += 3;
+            }
+            else
+            {
+                putPixel (x, y, shade);
+                x++;
+            }
+        }
+        markDirty (y, x0/3, x1/3);
+    }
+}
+
+void growBand (const span_t *spans, uint8 row, band_t *band)
+{
+    band->startRow = row;
+    band->startCol = spans[row].startCol;
+    band->endCol = spans[row].endCol;
+    uint16 needed = band->endCol - band->startCol; // groups in the spans
+    uint16 waste = 0; // groups outside them streamed by sharing the window
+    row++;
+    while (row < LCD_HEIGHT && spans[row].endCol != 0)
+    {
+        uint8 first = band->startCol < spans[row].startCol ? band->startCol : spans[row].startCol;
+        uint8 last = band->endCol > spans[row].endCol ? band->endCol : spans[row].endCol;
+        uint16 width = spans[row].endCol - spans[row].startCol;
+        uint16 newWaste = (last-first)*(row-band->startRow+1) - (needed+width);
+        if (newWaste > waste + WINDOW_GROUPS)
+            break;
+        band->startCol = first;
+        band->endCol = last;
+        needed += width;
+        waste = newWaste;
+        row++;
+    }
+    band->endRow = row;
+}
+
+/* Streams the given span of one row to an open RAMWR window */
+static void sendRow (uint8 row, uint8 startCol, uint8 endCol)
+{
+    const uint16 *group = &frame[row][startCol];
+    for (uint8 col = startCol; col <= endCol; col++)
+    {
+        uint16 packed = *group++;
+        burstWrite ((packed >> 7) & 0xF8);
+        burstWrite ((packed >> 2) & 0xF8);
+        burstWrite ((packed << 3) & 0xF8);
+    }
+}
+
+void flushFrame (void)
+{
+    uint8 row = 0;
+    while (row < LCD_HEIGHT)
+    {
+        if (dirty[row].endCol == 0)
+        {
+            row++;
+            continue;
+        }
+
+        band_t band;
+        growBand (dirty, row, &band);
+        setWindow (band.startCol, band.startRow, band.endCol-1, band.endRow-1);
+        beginBurst ();
+        for (row = band.startRow; row < band.endRow; row++)
+        {
+            sendRow (row, band.startCol, band.endCol-1);
+            dirty[row].endCol = 0;
+        }
+        endBurst ();
+    }
+}
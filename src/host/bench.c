@@ -0,0 +1,349 @@
+/*
+ * bench.c
+ *
+ * Times the drawing kernels of the firmware image on the ARM7TDMI
+ * simulator (iss.h): main.elf, as built for the flash, is booted through
+ * crt.s, InitController() and initLCD() are run, and each kernel is then
+ * called by name count times. The figures are MCK cycles of the real
+ * instruction stream with the flash wait states, the LCD bus and, for
+ * BUS=spi, the SPI paced by its clock. They are printed as JSON: cycles
+ * per frame, per row and per RAMWR byte, the bus stores (or SPI words) per
+ * frame, and the time per frame split into the CPU's busy time and its
+ * waiting on the SPI or PDC. free_ms is what the CPU has left of the frame
+ * period for making the next pixels, the period less the busy time;
+ * slack_ms is the period less the whole frame time, below 0 when the bus
+ * cannot keep up with the frame rate. A kernel that redraws the whole panel
+ * and takes longer than the period is reported on stderr as well.
+ * On the parallel bus measureStream() (lcdbench.c) is run too, for the
+ * rate of streamPixels() from SRAM and from flash.
+ *
+ * The animation loops are then run for count frame periods each, from
+ * reset, with the frame tick interrupting: the share of the time the CPU
+ * slept in nextFrame(), the frames presented and the frames that missed
+ * their tick (frameStats), and the IRQ and SVC stack used by the tick
+ * handler.
+ *
+ *   slmbench [-n count] [-t limits] main.elf
+ *
+ *   -n     frames per kernel and loop (8)
+ *   -t     check the cycles per frame against the limits in the text file
+ *          limits, a kernel name and the most cycles it may take per line
+ *          ('#' starts a comment), and fail if a kernel goes over; any
+ *          loop overrun, or a full IRQ or SVC stack, fails too
+ *
+ * "make bench" builds main.elf and runs it against host/limits.$(BUS).
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "lcd.h"
+#include "animate.h"
+#include "zernike.h"
+#include "st7529.h"
+#include "iss.h"
+
+#ifdef BUS_SPI
+#define BUS_STORES  busStats.bytes      // one word per byte latched
+#define BUS_NAME    "spi"
+#elif defined(BUS_LEGACY)
+#define BUS_STORES  busStats.stores
+#define BUS_NAME    "legacy"
+#else
+#define BUS_STORES  busStats.stores
+#define BUS_NAME    "parallel"
+#endif
+
+#define FRAME_CYCLES    (MCK / FRAME_RATE)
+#define SETUP_PERIODS   250     // a loop's longest set up, in frame periods
+
+// The exception stacks of crt.s, below _stack_end
+#define IRQ_STACK_TOP   (stackEnd - 16 - 16 - 128)
+#define IRQ_STACK_SIZE  128
+#define SVC_STACK_TOP   (IRQ_STACK_TOP - IRQ_STACK_SIZE)
+#define SVC_STACK_SIZE  128
+
+// The host's st7529.c charges its own bus model here; the simulator keeps
+// its own clock
+unsigned long hostCycles;
+AT91S_PIO hostPIOA;
+
+static uint32_t stackEnd;
+static uint32_t scratch; // free SRAM past .bss, for arguments
+
+static const int16 zernikeWeights[ZERNIKE_TERMS] = {
+    [ZERNIKE_DEFOCUS] = ZERNIKE_WAVE,
+    [ZERNIKE_ASTIG_0] = ZERNIKE_WAVE/2,
+    [ZERNIKE_COMA_X] = ZERNIKE_WAVE/2,
+    [ZERNIKE_SPHERICAL] = ZERNIKE_WAVE/4,
+};
+
+static uint32_t symbol (const char *name)
+{
+    uint32_t address = issSymbol (name);
+
+    if (address == 0)
+    {
+        fprintf (stderr, "slmbench: the image has no %s\n", name);
+        exit (1);
+    }
+    return address;
+}
+
+/* Call a function of the image to completion */
+static void call (const char *name, int argc, ...)
+{
+    uint32_t args[8];
+    va_list ap;
+
+    va_start (ap, argc);
+    for (int i = 0; i < argc; i++)
+        args[i] = va_arg (ap, unsigned);
+    va_end (ap);
+    issCall (symbol (name), args, argc, 0, NULL);
+}
+
+static void benchErase (void)
+{
+    call ("eraseDisplay", 0);
+}
+
+static void benchSlide (void)
+{
+    call ("slide", 4, APERTURE, MAX_STEPS, 0, rising);
+}
+
+static void benchWaves (void)
+{
+    call ("drawWaves", 3, WAVELENGTH, 0, rising);
+}
+
+static void benchTurbulence (void)
+{
+    call ("drawTurbulence", 1, 1);
+}
+
+static void benchZernike (void)
+{
+    call ("setZernike", 1, scratch);
+    call ("drawZernike", 0);
+}
+
+static void benchFrame (void)
+{
+    call ("clearFrame", 1, 0);
+    for (unsigned i = 0; i < 8; i++)
+        call ("fillRect", 5, i*30, i*20, i*30 + 29, i*20 + 19, i*4 + 3);
+    call ("flushFrame", 0);
+}
+
+static const struct {
+    const char *name;
+    void (*draw)(void);
+} kernels[] = {
+    { "erase",          benchErase },
+    { "slide",          benchSlide },
+    { "waves",          benchWaves },
+    { "turbulence",     benchTurbulence },
+    { "zernike",        benchZernike },
+    { "frame",          benchFrame },
+};
+
+static const char *loops[] = {
+    "wavesLoop", "turbulenceLoop", "zernikeLoop",
+};
+
+#define KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+#define LOOPS   (sizeof(loops) / sizeof(loops[0]))
+
+/* The limit for a kernel in the limits file, 0 if it has none */
+static unsigned long long limitOf (FILE *limits, const char *name)
+{
+    char line[100], kernel[40];
+    unsigned long long limit;
+
+    rewind (limits);
+    while (fgets (line, sizeof(line), limits))
+        if (sscanf (line, "%39s %llu", kernel, &limit) == 2 &&
+                kernel[0] != '#' && strcmp (kernel, name) == 0)
+            return limit;
+    return 0;
+}
+
+/* Reset, and run main() up to where the loops start */
+static void boot (void)
+{
+    issBoot ();
+    call ("InitController", 0);
+    call ("initLCD", 0);
+    issWrite (scratch, zernikeWeights, sizeof(zernikeWeights));
+}
+
+static double ms (double cycles)
+{
+    return cycles * 1000 / MCK;
+}
+
+int main (int argc, char **argv)
+{
+    unsigned long count = 8;
+    FILE *limits = NULL;
+    const char *elf = NULL;
+    int over = 0;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if (strcmp (argv[arg], "-n") == 0 && arg + 1 < argc)
+            count = strtoul (argv[++arg], NULL, 0);
+        else if (strcmp (argv[arg], "-t") == 0 && arg + 1 < argc)
+        {
+            if ((limits = fopen (argv[++arg], "r")) == NULL)
+            {
+                perror (argv[arg]);
+                return 1;
+            }
+        }
+        else if (argv[arg][0] != '-' && elf == NULL)
+            elf = argv[arg];
+        else
+            elf = NULL, arg = argc + 1;
+    }
+    if (elf == NULL || arg > argc)
+    {
+        fprintf (stderr, "usage: %s [-n count] [-t limits] main.elf\n", argv[0]);
+        return 2;
+    }
+    if (count == 0)
+        count = 1;
+    if (!issLoad (elf))
+        return 1;
+    stackEnd = symbol ("_stack_end");
+    scratch = (symbol ("_bss_end") + 3) & ~3;
+
+    boot ();
+
+    printf ("{\n");
+    printf ("  \"bus\": \"%s\",\n", BUS_NAME);
+    printf ("  \"mck\": %lu,\n", (unsigned long)MCK);
+    printf ("  \"frames\": %lu,\n", count);
+    printf ("  \"kernels\": {\n");
+
+    for (unsigned k = 0; k < KERNELS; k++)
+    {
+        // Once to warm up, so every kernel starts from a drawn panel
+        kernels[k].draw ();
+
+        unsigned long bytes = busStats.pixels, stores = BUS_STORES;
+        issStats_t start = issStats;
+        for (unsigned long f = 0; f < count; f++)
+            kernels[k].draw ();
+
+        double cycles = (double)(issStats.cycles - start.cycles) / count;
+        double waiting = (double)(issStats.waiting - start.waiting) / count;
+        double perFrame = (double)(busStats.pixels - bytes) / count;
+        double rows = perFrame / LCD_WIDTH;
+        double busy = cycles - waiting;
+
+        printf ("    \"%s\": { \"cycles_per_frame\": %.0f, \"cycles_per_row\": %.0f, "
+                "\"cycles_per_byte\": %.2f, \"%s_per_frame\": %.0f, "
+                "\"bytes_per_frame\": %.0f, \"ms_per_frame\": %.3f, "
+                "\"busy_ms\": %.3f, \"waiting_ms\": %.3f, \"free_ms\": %.3f, "
+                "\"slack_ms\": %.3f }%s\n",
+                kernels[k].name, cycles, rows ? cycles / rows : 0,
+                perFrame ? cycles / perFrame : 0,
+#ifdef BUS_SPI
+                "words",
+#else
+                "stores",
+#endif
+                (double)(BUS_STORES - stores) / count, perFrame,
+                ms (cycles), ms (busy), ms (waiting), ms (FRAME_CYCLES - busy),
+                ms (FRAME_CYCLES - cycles), k + 1 < KERNELS ? "," : "");
+
+        // Only the kernels that redraw the whole panel have to fit a period
+        if (perFrame >= LCD_WIDTH * LCD_HEIGHT && cycles > FRAME_CYCLES)
+            fprintf (stderr, "%s: %.2fms per frame, over the %.2fms frame period%s\n",
+                    kernels[k].name, ms (cycles), ms (FRAME_CYCLES),
+                    busy < FRAME_CYCLES ? " (bus too slow)" : "");
+
+        unsigned long long limit = limits ? limitOf (limits, kernels[k].name) : 0;
+        if (limit && cycles > limit)
+        {
+            fprintf (stderr, "%s: %.0f cycles per frame, over the limit of %llu\n",
+                    kernels[k].name, cycles, limit);
+            over++;
+        }
+    }
+    printf ("  },\n");
+
+    // measureStream() (lcdbench.c), timed by the firmware itself on TC1
+    if (issSymbol ("measureStream"))
+    {
+        uint32_t rate[2];
+        call ("measureStream", 0);
+        issRead (symbol ("streamRate"), rate, sizeof(rate));
+        printf ("  \"stream\": { \"ram_bytes_per_s\": %lu, \"flash_bytes_per_s\": %lu },\n",
+                (unsigned long)rate[STREAM_RAM], (unsigned long)rate[STREAM_FLASH]);
+    }
+
+    printf ("  \"loops\": {\n");
+
+    for (unsigned l = 0; l < LOOPS; l++)
+    {
+        uint32_t stats[2], first[2], ticks; // frameStats_t: frames, overruns
+
+        // From reset, so every loop finds the stacks untouched; its set up,
+        // up to the first tick, is not counted
+        boot ();
+        issCall (symbol (loops[l]), NULL, 0, FRAME_CYCLES, NULL);
+        for (int wait = 0; wait < SETUP_PERIODS; wait++)
+        {
+            issRead (symbol ("ticks"), &ticks, sizeof(ticks));
+            if (ticks)
+                break;
+            issResume (FRAME_CYCLES, NULL);
+        }
+        issStats_t start = issStats;
+        issRead (symbol ("frameStats"), first, sizeof(first));
+        issResume ((unsigned long long)count * FRAME_CYCLES, NULL);
+        issRead (symbol ("frameStats"), stats, sizeof(stats));
+        stats[0] -= first[0];
+        stats[1] -= first[1];
+
+        double sleeping = (double)(issStats.sleeping - start.sleeping) / count;
+        double busy = FRAME_CYCLES - sleeping;
+        uint32_t irq = issStackUsed (IRQ_STACK_TOP, IRQ_STACK_SIZE);
+        uint32_t svc = issStackUsed (SVC_STACK_TOP, SVC_STACK_SIZE);
+
+        printf ("    \"%s\": { \"busy_cycles_per_frame\": %.0f, \"busy_ms_per_frame\": %.3f, "
+                "\"free_ms_per_frame\": %.3f, \"frames\": %lu, \"overruns\": %lu, "
+                "\"irq_stack\": %lu, \"svc_stack\": %lu }%s\n",
+                loops[l], busy, ms (busy), ms (sleeping),
+                (unsigned long)stats[0], (unsigned long)stats[1],
+                (unsigned long)irq, (unsigned long)svc, l + 1 < LOOPS ? "," : "");
+
+        // A loop with a limit has to keep up with the tick as well
+        unsigned long long limit = limits ? limitOf (limits, loops[l]) : 0;
+        if (limit && (busy > limit || stats[1]))
+        {
+            fprintf (stderr, "%s: %.0f cycles per frame, over the limit of %llu, "
+                    "%lu overruns\n", loops[l], busy, limit, (unsigned long)stats[1]);
+            over++;
+        }
+        if (irq >= IRQ_STACK_SIZE || svc >= SVC_STACK_SIZE)
+        {
+            fprintf (stderr, "%s: %lu bytes of IRQ stack, %lu of SVC, the stacks are full\n",
+                    loops[l], (unsigned long)irq, (unsigned long)svc);
+            over++;
+        }
+    }
+    printf ("  }\n}\n");
+
+    if (limits)
+        fclose (limits);
+    return over ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+/*
+ * flash.c
+ *
+ * Host version of ../flash.c: the sequence store is a plain array
+ *
+ * John Howe 2010
+ */
+
+#include <string.h>
+#include "seqstore.h"
+
+unsigned char hostStore[STORE_SIZE];
+
+uint8 writeStorePage (uint16 page, const uint32 *data)
+{
+    if (page >= STORE_PAGES)
+        return FALSE;
+    // pageData() filled the first STORE_PAGE bytes (uint32 is 64 bits here)
+    memcpy (hostStore + page*STORE_PAGE, data, STORE_PAGE);
+    return TRUE;
+}
@@ -0,0 +1,89 @@
+/*
+ * host.h
+ *
+ * Host (Linux) build of the firmware. Forced into every file with -include
+ * by "make host": the on-chip peripherals the shared code touches are
+ * replaced by plain structures in host memory, and the LCD bus by an
+ * emulated controller.
+ *
+ * John Howe 2010
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include "AT91SAM7S256.h"
+
+#undef AT91C_BASE_PIOA
+extern AT91S_PIO hostPIOA;
+#define AT91C_BASE_PIOA (&hostPIOA)
+
+#undef AT91C_BASE_PMC
+extern AT91S_PMC hostPMC;
+#define AT91C_BASE_PMC (&hostPMC)
+
+// USART0 and its PDC channel, simulated by uart.c
+#undef AT91C_BASE_US0
+extern AT91S_USART hostUS0;
+#define AT91C_BASE_US0 (&hostUS0)
+
+#undef AT91C_BASE_PDC_US0
+extern AT91S_PDC hostPDC_US0;
+#define AT91C_BASE_PDC_US0 (&hostPDC_US0)
+
+// The DBGU and its PDC channel for the telemetry, sent on by uart.c
+#undef AT91C_BASE_DBGU
+extern AT91S_DBGU hostDBGU;
+#define AT91C_BASE_DBGU (&hostDBGU)
+
+#undef AT91C_BASE_PDC_DBGU
+extern AT91S_PDC hostPDC_DBGU;
+#define AT91C_BASE_PDC_DBGU (&hostPDC_DBGU)
+
+// LCD bus stores are decoded by the ST7529 emulation, unless PIO_WRITE is
+// defined as a plain store to time the driver code alone
+void hostPioWrite (volatile unsigned int *reg, unsigned int value);
+#ifndef PIO_WRITE
+#define PIO_WRITE(reg, value) hostPioWrite (&(reg), (value))
+#endif
+
+// The SPI and its PDC channel for the serial back-end, modelled by spi.c
+#undef AT91C_BASE_SPI
+extern AT91S_SPI hostSPI;
+#define AT91C_BASE_SPI (&hostSPI)
+
+void hostSpiWrite (volatile unsigned int *reg, unsigned int value);
+#ifndef SPI_WRITE
+#define SPI_WRITE(reg, value) hostSpiWrite (&(reg), (value))
+#endif
+
+// No interrupts to mask (timers.h)
+#define maskIRQ() 0U
+#define restoreIRQ(cpsr) ((void)(cpsr))
+
+// The model's clock, in MCK cycles of bus time alone: PIO_CYCLES for each
+// LCD bus store, and the SPI's shifting (host/spi.c). The code in between
+// is not timed, so it is a count of bus stores, not a cycle count.
+extern unsigned long hostCycles;
+#define PIO_CYCLES 3
+
+/* Print the modelled bus time per frame since hostBusStart(), for
+ * whichever back-end was built */
+void hostBusStart (void);
+void hostBusModel (unsigned long frames);
+
+// The flash sequence store, programmed by host/flash.c
+extern unsigned char hostStore[];
+#define STORE_BASE ((const unsigned char *)hostStore)
+
+/* Receive one character on the simulated USART0. Returns FALSE if the PDC
+ * had no buffer for it (overrun). */
+int hostUsartReceive (unsigned char c);
+/* The line has been idle for the receiver time-out */
+void hostUsartIdle (void);
+
+/* Send what the DBGU's PDC has been given to hostTelemetry (or nowhere),
+ * as if the line had all the time it needed. Done by nextFrame(). */
+void hostDbguTransmit (void);
+
+#endif
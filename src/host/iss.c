@@ -0,0 +1,1357 @@
+/*
+ * iss.c
+ *
+ * ARM7TDMI instruction set simulator, see iss.h.
+ *
+ * Timing. Each instruction costs the cycles the ARM7TDMI technical
+ * reference manual gives it (S, N and I cycles), with every memory cycle
+ * stretched by the wait states of the memory it goes to:
+ *
+ *   flash          1 + FWS cycles (MC_FMR, one wait state once
+ *                  InitController() has run); no sequential bursts
+ *   SRAM           1 cycle
+ *   peripherals    PERIPH_CYCLES, through the APB bridge
+ *
+ * An instruction fetch is charged to the memory the PC is in, a data
+ * access to the memory it addresses, so a loop in .ramfunc that loads a
+ * table from flash pays for the table and not for its own fetches. A
+ * branch, or any write to the PC, refills the pipeline at the target: two
+ * more fetches. Multiplies take their early termination cycles from the
+ * multiplier operand.
+ *
+ * Not modelled: Thumb state, coprocessors, aborts (an access outside the
+ * memory map stops the simulator), the MC remap and the PDC channels other
+ * than the SPI's. The SPI shifts (8 + BITS) bits in SCBR MCK cycles each,
+ * plus DLYBCT*32 between words, and the PDC takes the next buffer the
+ * moment the current one is done. Cycles spent reading an SPI or PDC
+ * register that is not ready yet count as waiting.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "lcd.h"
+#include "st7529.h"
+#include "iss.h"
+
+#define FLASH_SIZE      (256*1024)
+#define SRAM_SIZE       (64*1024)
+#define SRAM_BASE       0x00200000
+#define PERIPH_BASE     0xF0000000
+#define PERIPH_CYCLES   2               // APB access, one wait state
+
+#define ISS_RETURN      0x0FFFFFF0      // lr of issCall(), outside the memory map
+#define STACK_PAINT     0xC5C5C5C5
+
+// Peripheral bases (AT91SAM7S256.h)
+#define TC_BASE         0xFFFA0000
+#define SPI_BASE        0xFFFE0000
+#define AIC_BASE        0xFFFFF000
+#define PIOA_BASE       0xFFFFF400
+#define PMC_BASE        0xFFFFFC00
+#define MC_BASE         0xFFFFFF00
+
+// Processor modes and PSR bits
+#define MODE_USR        0x10
+#define MODE_FIQ        0x11
+#define MODE_IRQ        0x12
+#define MODE_SVC        0x13
+#define MODE_ABT        0x17
+#define MODE_UND        0x1B
+#define MODE_SYS        0x1F
+#define PSR_N           0x80000000
+#define PSR_Z           0x40000000
+#define PSR_C           0x20000000
+#define PSR_V           0x10000000
+#define PSR_I           0x80
+#define PSR_F           0x40
+#define PSR_T           0x20
+
+issStats_t issStats;
+
+static uint8 flash[FLASH_SIZE];
+static uint8 image[FLASH_SIZE];         // flash as loaded, for issBoot()
+static uint8 sram[SRAM_SIZE];
+
+static struct {
+    char *name;
+    uint32_t value;
+} *symbols;
+static unsigned symbolCount;
+
+static struct {
+    uint32_t r[16];
+    uint32_t cpsr;
+    uint32_t spsr;                      // of the current mode
+    uint32_t pc;                        // the instruction executing
+    // Banked registers: r13, r14 and the SPSR of each mode (0 for usr and
+    // sys), r8-r12 of usr and fiq
+    uint32_t bank13[6], bank14[6], bankSpsr[6];
+    uint32_t usr8[5], fiq8[5];
+    uint32_t cycles;                    // of the instruction executing
+    int sleeping;
+} cpu;
+
+// Peripherals
+static uint32_t mcFmr;
+static uint32_t pmcScsr;
+static struct {
+    uint32_t cmr, rc, imr;
+    uint32_t status;                    // flags not yet read from TC_SR
+    int running;
+    unsigned long long start;           // cycle the counter was last at 0
+    unsigned long long seen;            // compares and overflows up to here are in status
+} tc[3];
+static struct {
+    uint32_t smr[32], svr[32];
+    uint32_t imr, ffsr, spu;
+    uint32_t pending;                   // edge and forced sources set by ISCR
+    int level[9];                       // priorities in service, IVR to EOICR
+    int depth;
+} aic;
+static struct {
+    uint32_t mr, csr0, tnpr, tncr;
+    unsigned long long taken;           // cycle the PDC takes the TNPR buffer
+    unsigned long long idle;            // cycle the last word is out
+} spi;
+static unsigned long long waitStart;
+static int waitingOn;
+
+// The interrupt lines, looked at again when a timer is next due or the
+// AIC or a timer has been accessed
+static int irqLine, fiqLine;
+static unsigned long long linesDue;
+
+static void fault (const char *what, uint32_t address)
+{
+    fprintf (stderr, "iss: %s %08X at pc %08X (cycle %llu)\n",
+            what, address, cpu.pc, issStats.cycles);
+    exit (1);
+}
+
+/* --- Timers and interrupts ------------------------------------------- */
+
+static const unsigned tcDivider[8] = { 2, 8, 32, 128, 1024, 0, 0, 0 };
+
+/* Brings a channel's status up to the current cycle */
+static void tcUpdate (int n)
+{
+    unsigned div = tcDivider[tc[n].cmr & 7];
+    if (!tc[n].running || div == 0)
+        return;
+
+    unsigned long long ticks = (issStats.cycles - tc[n].start) / div;
+    unsigned long long before = (tc[n].seen - tc[n].start) / div;
+    int autoReset = (tc[n].cmr & AT91C_TC_WAVE) &&
+            (tc[n].cmr & AT91C_TC_WAVESEL) == AT91C_TC_WAVESEL_UP_AUTO;
+    unsigned long long period = autoReset && tc[n].rc ? tc[n].rc : 0x10000;
+
+    if (ticks / period != before / period)
+        tc[n].status |= period == 0x10000 ? AT91C_TC_COVFS : 0;
+    if (tc[n].rc && ticks != before)
+    {
+        // An RC compare between the two
+        unsigned long long last = ticks / period * period + tc[n].rc;
+        if (last > ticks)
+            last -= period;
+        if (last > before && last <= ticks)
+            tc[n].status |= AT91C_TC_CPCS;
+    }
+    tc[n].seen = issStats.cycles;
+}
+
+static uint16_t tcValue (int n)
+{
+    unsigned div = tcDivider[tc[n].cmr & 7];
+    if (!tc[n].running || div == 0)
+        return 0;
+    unsigned long long ticks = (issStats.cycles - tc[n].start) / div;
+    int autoReset = (tc[n].cmr & AT91C_TC_WAVE) &&
+            (tc[n].cmr & AT91C_TC_WAVESEL) == AT91C_TC_WAVESEL_UP_AUTO;
+    return autoReset && tc[n].rc ? ticks % tc[n].rc : ticks & 0xFFFF;
+}
+
+/* The next cycle a channel sets a flag, an enabled one if enabled is
+ * TRUE; 0 if never */
+static unsigned long long tcNext (int n, int enabled)
+{
+    unsigned div = tcDivider[tc[n].cmr & 7];
+    if (!tc[n].running || div == 0 || (enabled && !tc[n].imr))
+        return 0;
+    unsigned long long ticks = (issStats.cycles - tc[n].start) / div;
+    int autoReset = (tc[n].cmr & AT91C_TC_WAVE) &&
+            (tc[n].cmr & AT91C_TC_WAVESEL) == AT91C_TC_WAVESEL_UP_AUTO;
+    unsigned long long period = autoReset && tc[n].rc ? tc[n].rc : 0x10000;
+    unsigned long long at = (ticks / period + 1) * period;
+    if ((!enabled || (tc[n].imr & AT91C_TC_CPCS)) && tc[n].rc && !autoReset)
+    {
+        unsigned long long c = ticks / period * period + tc[n].rc;
+        if (c <= ticks)
+            c += period;
+        at = c;
+    }
+    return tc[n].start + at * div;
+}
+
+/* Interrupt sources the AIC sees asserted */
+static uint32_t aicSources (void)
+{
+    uint32_t sources = aic.pending;
+    for (int n = 0; n < 3; n++)
+    {
+        tcUpdate (n);
+        if (tc[n].status & tc[n].imr)
+            sources |= 1 << (AT91C_ID_TC0 + n);
+    }
+    return sources;
+}
+
+static int aicFiq (void)
+{
+    return (aicSources () & aic.imr & (aic.ffsr | 1)) != 0;
+}
+
+/* The highest priority IRQ source above the one in service, -1 if none */
+static int aicIrq (void)
+{
+    uint32_t active = aicSources () & aic.imr & ~(aic.ffsr | 1);
+    int best = -1, level = aic.depth ? aic.level[aic.depth-1] : -1;
+
+    for (int id = 1; id < 32; id++)
+        if ((active & (1 << id)) && (int)(aic.smr[id] & 7) > level &&
+                (best < 0 || (aic.smr[id] & 7) > (aic.smr[best] & 7)))
+            best = id;
+    return best;
+}
+
+static void updateLines (void)
+{
+    fiqLine = aicFiq ();
+    irqLine = aicIrq () >= 0;
+    linesDue = ~0ULL;
+    for (int n = 0; n < 3; n++)
+    {
+        unsigned long long t = tcNext (n, FALSE);
+        if (t && t < linesDue)
+            linesDue = t;
+    }
+}
+
+/* --- Memory -------------------------------------------------------- */
+
+static uint32_t flashCycles (void)
+{
+    return 1 + ((mcFmr & AT91C_MC_FWS) >> 8);
+}
+
+static void waitFor (int ready)
+{
+    if (!ready && !waitingOn)
+    {
+        waitingOn = TRUE;
+        waitStart = issStats.cycles;
+    }
+    else if (ready && waitingOn)
+    {
+        waitingOn = FALSE;
+        issStats.waiting += issStats.cycles - waitStart;
+    }
+}
+
+static uint32_t spiWordCycles (void)
+{
+    uint32_t scbr = (spi.csr0 & AT91C_SPI_SCBR) >> 8;
+    uint32_t bits = 8 + ((spi.csr0 & AT91C_SPI_BITS) >> 4);
+    return bits * (scbr ? scbr : 1) + 32 * ((spi.csr0 & AT91C_SPI_DLYBCT) >> 24);
+}
+
+static uint32_t spiRead (uint32_t offset)
+{
+    unsigned long long now = issStats.cycles;
+    uint32_t word = spiWordCycles ();
+    uint32_t sr = 0;
+
+    if (offset == offsetof (AT91S_SPI, SPI_SR))
+    {
+        // The last word leaves TDR for the shifter one word before the end
+        if (now + word >= spi.idle)
+            sr |= AT91C_SPI_TDRE | AT91C_SPI_TXBUFE | AT91C_SPI_ENDTX;
+        if (now >= spi.idle)
+            sr |= AT91C_SPI_TXEMPTY;
+        waitFor (sr & AT91C_SPI_TDRE);
+        return sr;
+    }
+    if (offset == offsetof (AT91S_SPI, SPI_MR))
+        return spi.mr;
+    if (offset == offsetof (AT91S_SPI, SPI_CSR[0]))
+        return spi.csr0;
+    if (offset == 0x100 + offsetof (AT91S_PDC, PDC_TNCR))
+    {
+        waitFor (now >= spi.taken);
+        return now >= spi.taken ? 0 : spi.tncr;
+    }
+    if (offset == 0x100 + offsetof (AT91S_PDC, PDC_TNPR))
+        return spi.tnpr;
+    return 0;
+}
+
+static uint32_t load32 (uint32_t address);
+
+static void spiWrite (uint32_t offset, uint32_t value)
+{
+    unsigned long long now = issStats.cycles;
+    uint32_t word = spiWordCycles ();
+
+    if (offset == offsetof (AT91S_SPI, SPI_MR))
+        spi.mr = value;
+    else if (offset == offsetof (AT91S_SPI, SPI_CSR[0]))
+        spi.csr0 = value;
+    else if (offset == offsetof (AT91S_SPI, SPI_TDR))
+    {
+        spi.idle = (spi.idle > now ? spi.idle : now) + word;
+        st7529Serial (value & 0x1FF);
+    }
+    else if (offset == 0x100 + offsetof (AT91S_PDC, PDC_TNPR))
+        spi.tnpr = value;
+    else if (offset == 0x100 + offsetof (AT91S_PDC, PDC_TNCR) && value)
+    {
+        // Taken once the buffer ahead is out; the words are read now, the
+        // driver does not touch a buffer it has queued
+        spi.tncr = value;
+        spi.taken = spi.idle > now ? spi.idle : now;
+        spi.idle = spi.taken + (unsigned long long)value * word;
+        for (uint32_t i = 0; i < value; i++)
+        {
+            uint32_t a = spi.tnpr + 2*i;
+            st7529Serial ((load32 (a & ~3) >> ((a & 2) * 8)) & 0x1FF);
+        }
+    }
+}
+
+static uint32_t aicRead (uint32_t offset)
+{
+    if (offset == offsetof (AT91S_AIC, AIC_IVR))
+    {
+        int id = aicIrq ();
+        if (id < 0)
+            return aic.spu;
+        aic.level[aic.depth++] = aic.smr[id] & 7;
+        if ((aic.smr[id] & AT91C_AIC_SRCTYPE) == AT91C_AIC_SRCTYPE_POSITIVE_EDGE)
+            aic.pending &= ~(1 << id);
+        return aic.svr[id];
+    }
+    if (offset == offsetof (AT91S_AIC, AIC_FVR))
+        return aic.svr[0];
+    if (offset == offsetof (AT91S_AIC, AIC_IPR))
+        return aicSources ();
+    if (offset == offsetof (AT91S_AIC, AIC_IMR))
+        return aic.imr;
+    if (offset == offsetof (AT91S_AIC, AIC_FFSR))
+        return aic.ffsr;
+    if (offset < 0x80)
+        return aic.smr[offset/4];
+    if (offset < 0x100)
+        return aic.svr[(offset-0x80)/4];
+    return 0;
+}
+
+static void aicWrite (uint32_t offset, uint32_t value)
+{
+    if (offset < 0x80)
+        aic.smr[offset/4] = value;
+    else if (offset < 0x100)
+        aic.svr[(offset-0x80)/4] = value;
+    else if (offset == offsetof (AT91S_AIC, AIC_IECR))
+        aic.imr |= value;
+    else if (offset == offsetof (AT91S_AIC, AIC_IDCR))
+        aic.imr &= ~value;
+    else if (offset == offsetof (AT91S_AIC, AIC_ICCR))
+        aic.pending &= ~value;
+    else if (offset == offsetof (AT91S_AIC, AIC_ISCR))
+        aic.pending |= value;
+    else if (offset == offsetof (AT91S_AIC, AIC_EOICR))
+    {
+        if (aic.depth)
+            aic.depth--;
+    }
+    else if (offset == offsetof (AT91S_AIC, AIC_SPU))
+        aic.spu = value;
+    else if (offset == offsetof (AT91S_AIC, AIC_FFER))
+        aic.ffsr |= value;
+    else if (offset == offsetof (AT91S_AIC, AIC_FFDR))
+        aic.ffsr &= ~value;
+}
+
+static uint32_t tcRead (int n, uint32_t offset)
+{
+    tcUpdate (n);
+    switch (offset)
+    {
+        case offsetof (AT91S_TC, TC_CV): return tcValue (n);
+        case offsetof (AT91S_TC, TC_RC): return tc[n].rc;
+        case offsetof (AT91S_TC, TC_CMR): return tc[n].cmr;
+        case offsetof (AT91S_TC, TC_IMR): return tc[n].imr;
+        case offsetof (AT91S_TC, TC_SR):
+        {
+            uint32_t sr = tc[n].status | (tc[n].running ? AT91C_TC_CLKSTA : 0);
+            tc[n].status = 0;
+            return sr;
+        }
+    }
+    return 0;
+}
+
+static void tcWrite (int n, uint32_t offset, uint32_t value)
+{
+    tcUpdate (n);
+    switch (offset)
+    {
+        case offsetof (AT91S_TC, TC_CCR):
+            if (value & AT91C_TC_CLKDIS)
+                tc[n].running = FALSE;
+            else if (value & AT91C_TC_CLKEN)
+                tc[n].running = TRUE;
+            if ((value & AT91C_TC_SWTRG) && tc[n].running)
+                tc[n].start = tc[n].seen = issStats.cycles;
+            break;
+        case offsetof (AT91S_TC, TC_CMR): tc[n].cmr = value; break;
+        case offsetof (AT91S_TC, TC_RC): tc[n].rc = value & 0xFFFF; break;
+        case offsetof (AT91S_TC, TC_IER): tc[n].imr |= value; break;
+        case offsetof (AT91S_TC, TC_IDR): tc[n].imr &= ~value; break;
+    }
+}
+
+static uint32_t periphRead (uint32_t address)
+{
+    cpu.cycles += PERIPH_CYCLES;
+    if ((address >= TC_BASE && address < TC_BASE + 0xC0) ||
+            (address >= AIC_BASE && address < AIC_BASE + 0x200))
+        linesDue = 0;
+    if (address >= TC_BASE && address < TC_BASE + 0xC0)
+        return tcRead ((address - TC_BASE) / 0x40, (address - TC_BASE) % 0x40);
+    if (address >= SPI_BASE && address < SPI_BASE + 0x200)
+        return spiRead (address - SPI_BASE);
+    if (address >= AIC_BASE && address < AIC_BASE + 0x200)
+        return aicRead (address - AIC_BASE);
+    if (address >= PIOA_BASE && address < PIOA_BASE + 0x200)
+    {
+        uint32_t offset = address - PIOA_BASE;
+        if (offset == offsetof (AT91S_PIO, PIO_PDSR))
+            return hostPIOA.PIO_ODSR;
+        return *(volatile unsigned int *)((char *)&hostPIOA + offset);
+    }
+    if (address == PMC_BASE + offsetof (AT91S_PMC, PMC_SR))
+        return AT91C_PMC_MOSCS | AT91C_PMC_LOCK | AT91C_PMC_MCKRDY;
+    if (address == PMC_BASE + offsetof (AT91S_PMC, PMC_SCSR))
+        return pmcScsr;
+    if (address == MC_BASE + offsetof (AT91S_MC, MC_FMR))
+        return mcFmr;
+    if (address == MC_BASE + offsetof (AT91S_MC, MC_FSR))
+        return AT91C_MC_FRDY;
+    // USARTs and the DBGU always ready to send, and nothing received
+    return AT91C_US_TXRDY | AT91C_US_TXEMPTY | AT91C_US_ENDTX | AT91C_US_TXBUFE;
+}
+
+static void periphWrite (uint32_t address, uint32_t value)
+{
+    cpu.cycles += PERIPH_CYCLES;
+    if ((address >= TC_BASE && address < TC_BASE + 0xC0) ||
+            (address >= AIC_BASE && address < AIC_BASE + 0x200))
+        linesDue = 0;
+    if (address >= TC_BASE && address < TC_BASE + 0xC0)
+        tcWrite ((address - TC_BASE) / 0x40, (address - TC_BASE) % 0x40, value);
+    else if (address >= SPI_BASE && address < SPI_BASE + 0x200)
+        spiWrite (address - SPI_BASE, value);
+    else if (address >= AIC_BASE && address < AIC_BASE + 0x200)
+        aicWrite (address - AIC_BASE, value);
+    else if (address >= PIOA_BASE && address < PIOA_BASE + 0x200)
+        hostPioWrite ((volatile unsigned int *)((char *)&hostPIOA + address - PIOA_BASE), value);
+    else if (address == PMC_BASE + offsetof (AT91S_PMC, PMC_SCDR))
+    {
+        if (value & AT91C_PMC_PCK)
+            cpu.sleeping = TRUE;
+    }
+    else if (address == MC_BASE + offsetof (AT91S_MC, MC_FMR))
+        mcFmr = value;
+}
+
+/* Where an address is in host memory, or NULL for a peripheral. Charges
+ * the access to the instruction. */
+static uint8 *memory (uint32_t address)
+{
+    if (address < 0x00200000)
+    {
+        cpu.cycles += flashCycles ();
+        return &flash[address & (FLASH_SIZE-1)];
+    }
+    if (address < 0x00300000)
+    {
+        cpu.cycles += 1;
+        return &sram[address & (SRAM_SIZE-1)];
+    }
+    if (address >= PERIPH_BASE)
+        return NULL;
+    fault ("access outside the memory map,", address);
+    return NULL;
+}
+
+static uint32_t load32 (uint32_t address)
+{
+    uint8 *p = memory (address & ~3);
+    uint32_t v;
+
+    if (p == NULL)
+        return periphRead (address & ~3);
+    memcpy (&v, p, 4);
+    // An unaligned LDR rotates the word
+    if (address & 3)
+        v = (v >> ((address & 3) * 8)) | (v << (32 - (address & 3) * 8));
+    return v;
+}
+
+static uint32_t load16 (uint32_t address)
+{
+    uint8 *p = memory (address & ~1);
+    if (p == NULL)
+        return periphRead (address & ~3) >> ((address & 2) * 8) & 0xFFFF;
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t load8 (uint32_t address)
+{
+    uint8 *p = memory (address);
+    if (p == NULL)
+        return periphRead (address & ~3) >> ((address & 3) * 8) & 0xFF;
+    return *p;
+}
+
+static void store (uint32_t address, uint32_t value, int size)
+{
+    uint8 *p = memory (address & ~(size-1));
+    if (p == NULL)
+        periphWrite (address & ~3, value);
+    else
+        memcpy (p, &value, size);
+}
+
+/* Fetch, charged to the memory the PC is in */
+static uint32_t fetch (uint32_t address)
+{
+    if (address >= SRAM_BASE && address < SRAM_BASE + 0x00100000)
+    {
+        uint32_t v;
+        cpu.cycles += 1;
+        memcpy (&v, &sram[address & (SRAM_SIZE-1)], 4);
+        return v;
+    }
+    if (address < SRAM_BASE)
+    {
+        uint32_t v;
+        cpu.cycles += flashCycles ();
+        memcpy (&v, &flash[address & (FLASH_SIZE-1)], 4);
+        return v;
+    }
+    fault ("fetch outside the memory,", address);
+    return 0;
+}
+
+/* The two fetches that refill the pipeline at a new PC */
+static void refill (void)
+{
+    uint32_t f = cpu.r[15] >= SRAM_BASE ? 1 : flashCycles ();
+    cpu.cycles += 2*f;
+}
+
+/* --- Registers and modes ------------------------------------------- */
+
+static int bankOf (uint32_t mode)
+{
+    switch (mode & 0x1F)
+    {
+        case MODE_FIQ: return 1;
+        case MODE_IRQ: return 2;
+        case MODE_SVC: return 3;
+        case MODE_ABT: return 4;
+        case MODE_UND: return 5;
+    }
+    return 0;
+}
+
+static void setMode (uint32_t mode)
+{
+    int from = bankOf (cpu.cpsr), to = bankOf (mode);
+
+    if (from != to)
+    {
+        cpu.bank13[from] = cpu.r[13];
+        cpu.bank14[from] = cpu.r[14];
+        cpu.bankSpsr[from] = cpu.spsr;
+        if (from == 1 || to == 1)
+        {
+            memcpy (from == 1 ? cpu.fiq8 : cpu.usr8, &cpu.r[8], sizeof(cpu.usr8));
+            memcpy (&cpu.r[8], to == 1 ? cpu.fiq8 : cpu.usr8, sizeof(cpu.usr8));
+        }
+        cpu.r[13] = cpu.bank13[to];
+        cpu.r[14] = cpu.bank14[to];
+        cpu.spsr = cpu.bankSpsr[to];
+    }
+    cpu.cpsr = (cpu.cpsr & ~0x1F) | (mode & 0x1F);
+}
+
+static void setCpsr (uint32_t value)
+{
+    if (value & PSR_T)
+        fault ("Thumb state is not modelled, cpsr", value);
+    setMode (value);
+    cpu.cpsr = value;
+}
+
+/* Registers as an operand: the PC reads 8 ahead */
+static inline uint32_t reg (int n)
+{
+    return n == 15 ? cpu.pc + 8 : cpu.r[n];
+}
+
+static void setReg (int n, uint32_t value)
+{
+    if (n == 15)
+    {
+        cpu.r[15] = value & ~3;
+        refill ();
+    }
+    else
+        cpu.r[n] = value;
+}
+
+/* r8-r14 of user mode, for LDM/STM with the S bit */
+static uint32_t *userReg (int n)
+{
+    int bank = bankOf (cpu.cpsr);
+    if (n < 8 || n == 15 || bank == 0)
+        return &cpu.r[n];
+    if (n < 13)
+        return bank == 1 ? &cpu.usr8[n-8] : &cpu.r[n];
+    return n == 13 ? &cpu.bank13[0] : &cpu.bank14[0];
+}
+
+static void exception (uint32_t mode, uint32_t vector, uint32_t lr, uint32_t mask)
+{
+    uint32_t cpsr = cpu.cpsr;
+    setMode (mode);
+    cpu.spsr = cpsr;
+    cpu.r[14] = lr;
+    cpu.cpsr |= mask;
+    cpu.r[15] = vector;
+    refill ();
+}
+
+/* --- Instructions -------------------------------------------------- */
+
+static inline int condition (uint32_t insn)
+{
+    uint32_t f = cpu.cpsr;
+    int n = !!(f & PSR_N), z = !!(f & PSR_Z), c = !!(f & PSR_C), v = !!(f & PSR_V);
+
+    switch (insn >> 28)
+    {
+        case 0x0: return z;
+        case 0x1: return !z;
+        case 0x2: return c;
+        case 0x3: return !c;
+        case 0x4: return n;
+        case 0x5: return !n;
+        case 0x6: return v;
+        case 0x7: return !v;
+        case 0x8: return c && !z;
+        case 0x9: return !c || z;
+        case 0xA: return n == v;
+        case 0xB: return n != v;
+        case 0xC: return !z && n == v;
+        case 0xD: return z || n != v;
+        case 0xE: return TRUE;
+    }
+    return FALSE;
+}
+
+static inline uint32_t ror (uint32_t v, unsigned n)
+{
+    n &= 31;
+    return n ? (v >> n) | (v << (32 - n)) : v;
+}
+
+/* The register operand of a data processing instruction, and its carry */
+static uint32_t shifted (uint32_t insn, int *carry)
+{
+    int type = (insn >> 5) & 3;
+    uint32_t rm = insn & 15;
+    uint32_t v;
+    unsigned n;
+
+    if (insn & 0x10)
+    {
+        // Shift by register: one more cycle, and the PC reads 12 ahead
+        cpu.cycles += 1;
+        n = reg ((insn >> 8) & 15) & 0xFF;
+        v = rm == 15 ? cpu.pc + 12 : cpu.r[rm];
+        if (n == 0)
+            return v;
+        switch (type)
+        {
+            case 0:
+                if (n < 32) { *carry = (v >> (32 - n)) & 1; return v << n; }
+                *carry = n == 32 ? v & 1 : 0;
+                return 0;
+            case 1:
+                if (n < 32) { *carry = (v >> (n - 1)) & 1; return v >> n; }
+                *carry = n == 32 ? v >> 31 : 0;
+                return 0;
+            case 2:
+                if (n < 32) { *carry = (v >> (n - 1)) & 1; return (int32_t)v >> n; }
+                *carry = v >> 31;
+                return (int32_t)v >> 31;
+            default:
+                if ((n & 31) == 0) { *carry = v >> 31; return v; }
+                *carry = (v >> ((n & 31) - 1)) & 1;
+                return ror (v, n);
+        }
+    }
+
+    n = (insn >> 7) & 31;
+    v = reg (rm);
+    switch (type)
+    {
+        case 0:
+            if (n == 0)
+                return v;
+            *carry = (v >> (32 - n)) & 1;
+            return v << n;
+        case 1:
+            if (n == 0) { *carry = v >> 31; return 0; }
+            *carry = (v >> (n - 1)) & 1;
+            return v >> n;
+        case 2:
+            if (n == 0) { *carry = v >> 31; return (int32_t)v >> 31; }
+            *carry = (v >> (n - 1)) & 1;
+            return (int32_t)v >> n;
+        default:
+            if (n == 0)
+            {
+                // RRX
+                uint32_t r = (v >> 1) | ((cpu.cpsr & PSR_C) ? 0x80000000 : 0);
+                *carry = v & 1;
+                return r;
+            }
+            *carry = (v >> (n - 1)) & 1;
+            return ror (v, n);
+    }
+}
+
+static inline void setNZ (uint32_t r)
+{
+    cpu.cpsr = (cpu.cpsr & ~(PSR_N | PSR_Z)) | (r & PSR_N) | (r ? 0 : PSR_Z);
+}
+
+static uint32_t addFlags (uint32_t a, uint32_t b, uint32_t carryIn, int set)
+{
+    unsigned long long wide = (unsigned long long)a + b + carryIn;
+    uint32_t r = wide;
+
+    if (set)
+    {
+        setNZ (r);
+        cpu.cpsr = (cpu.cpsr & ~(PSR_C | PSR_V)) |
+                ((wide >> 32) ? PSR_C : 0) | ((~(a ^ b) & (a ^ r)) >> 31 ? PSR_V : 0);
+    }
+    return r;
+}
+
+static void dataProcessing (uint32_t insn)
+{
+    int carry = !!(cpu.cpsr & PSR_C);
+    int set = (insn >> 20) & 1;
+    int op = (insn >> 21) & 15;
+    int rd = (insn >> 12) & 15;
+    uint32_t a, b, r;
+
+    if (insn & (1 << 25))
+    {
+        unsigned rot = ((insn >> 8) & 15) * 2;
+        b = ror (insn & 0xFF, rot);
+        if (rot)
+            carry = b >> 31;
+    }
+    else
+        b = shifted (insn, &carry);
+    // The first operand after the shift, which may have cost a cycle
+    a = ((insn & 0x10) && !(insn & (1 << 25)) && ((insn >> 16) & 15) == 15) ?
+            cpu.pc + 12 : reg ((insn >> 16) & 15);
+
+    uint32_t c = !!(cpu.cpsr & PSR_C);
+    int logical = FALSE;
+    switch (op)
+    {
+        case 0x0: r = a & b; logical = TRUE; break;
+        case 0x1: r = a ^ b; logical = TRUE; break;
+        case 0x2: r = addFlags (a, ~b, 1, set); break;
+        case 0x3: r = addFlags (b, ~a, 1, set); break;
+        case 0x4: r = addFlags (a, b, 0, set); break;
+        case 0x5: r = addFlags (a, b, c, set); break;
+        case 0x6: r = addFlags (a, ~b, c, set); break;
+        case 0x7: r = addFlags (b, ~a, c, set); break;
+        case 0x8: r = a & b; logical = TRUE; break;
+        case 0x9: r = a ^ b; logical = TRUE; break;
+        case 0xA: r = addFlags (a, ~b, 1, set); break;
+        case 0xB: r = addFlags (a, b, 0, set); break;
+        case 0xC: r = a | b; logical = TRUE; break;
+        case 0xD: r = b; logical = TRUE; break;
+        case 0xE: r = a & ~b; logical = TRUE; break;
+        default:  r = ~b; logical = TRUE; break;
+    }
+    if (set && logical)
+    {
+        setNZ (r);
+        cpu.cpsr = (cpu.cpsr & ~PSR_C) | (carry ? PSR_C : 0);
+    }
+    if (op >= 0x8 && op <= 0xB)
+        return; // TST, TEQ, CMP, CMN
+
+    if (rd == 15 && set)
+    {
+        // Return from an exception: the SPSR goes back to the CPSR
+        uint32_t spsr = cpu.spsr;
+        setCpsr (spsr);
+    }
+    setReg (rd, r);
+}
+
+static unsigned multiplyCycles (uint32_t rs, int isSigned)
+{
+    if ((rs & 0xFFFFFF00) == 0 || (isSigned && (rs & 0xFFFFFF00) == 0xFFFFFF00))
+        return 1;
+    if ((rs & 0xFFFF0000) == 0 || (isSigned && (rs & 0xFFFF0000) == 0xFFFF0000))
+        return 2;
+    if ((rs & 0xFF000000) == 0 || (isSigned && (rs & 0xFF000000) == 0xFF000000))
+        return 3;
+    return 4;
+}
+
+static void multiply (uint32_t insn)
+{
+    int rd = (insn >> 16) & 15, rn = (insn >> 12) & 15;
+    uint32_t rs = cpu.r[(insn >> 8) & 15], rm = cpu.r[insn & 15];
+    uint32_t r = rm * rs;
+
+    cpu.cycles += multiplyCycles (rs, TRUE);
+    if (insn & (1 << 21))
+    {
+        r += cpu.r[rn];
+        cpu.cycles += 1;
+    }
+    cpu.r[rd] = r;
+    if (insn & (1 << 20))
+        setNZ (r);
+}
+
+static void multiplyLong (uint32_t insn)
+{
+    int hi = (insn >> 16) & 15, lo = (insn >> 12) & 15;
+    uint32_t rs = cpu.r[(insn >> 8) & 15], rm = cpu.r[insn & 15];
+    int isSigned = (insn >> 22) & 1;
+    unsigned long long r;
+
+    if (isSigned)
+        r = (unsigned long long)((long long)(int32_t)rm * (int32_t)rs);
+    else
+        r = (unsigned long long)rm * rs;
+    cpu.cycles += multiplyCycles (rs, isSigned) + 1;
+    if (insn & (1 << 21))
+    {
+        r += ((unsigned long long)cpu.r[hi] << 32) | cpu.r[lo];
+        cpu.cycles += 1;
+    }
+    cpu.r[lo] = r;
+    cpu.r[hi] = r >> 32;
+    if (insn & (1 << 20))
+        cpu.cpsr = (cpu.cpsr & ~(PSR_N | PSR_Z)) | ((r >> 32) & PSR_N) | (r ? 0 : PSR_Z);
+}
+
+static void psrTransfer (uint32_t insn)
+{
+    int spsr = (insn >> 22) & 1;
+
+    if (!(insn & (1 << 21)))
+    {
+        // MRS
+        cpu.r[(insn >> 12) & 15] = spsr ? cpu.spsr : cpu.cpsr;
+        return;
+    }
+
+    uint32_t v = (insn & (1 << 25)) ? ror (insn & 0xFF, ((insn >> 8) & 15) * 2) : cpu.r[insn & 15];
+    uint32_t mask = 0;
+    if (insn & (1 << 16)) mask |= 0x000000FF;
+    if (insn & (1 << 17)) mask |= 0x0000FF00;
+    if (insn & (1 << 18)) mask |= 0x00FF0000;
+    if (insn & (1 << 19)) mask |= 0xFF000000;
+    if (spsr)
+        cpu.spsr = (cpu.spsr & ~mask) | (v & mask);
+    else
+    {
+        if ((cpu.cpsr & 0x1F) == MODE_USR)
+            mask &= 0xFF000000;
+        setCpsr ((cpu.cpsr & ~mask) | (v & mask));
+    }
+}
+
+static void singleTransfer (uint32_t insn)
+{
+    int rn = (insn >> 16) & 15, rd = (insn >> 12) & 15;
+    int pre = (insn >> 24) & 1, up = (insn >> 23) & 1, byte = (insn >> 22) & 1;
+    int writeBack = (insn >> 21) & 1, isLoad = (insn >> 20) & 1;
+    uint32_t offset, base = reg (rn), address;
+
+    if (insn & (1 << 25))
+    {
+        int carry = 0;
+        offset = shifted (insn & ~0x10, &carry);
+    }
+    else
+        offset = insn & 0xFFF;
+    uint32_t moved = up ? base + offset : base - offset;
+    address = pre ? moved : base;
+
+    if (isLoad)
+    {
+        uint32_t v = byte ? load8 (address) : load32 (address);
+        cpu.cycles += 1;
+        if (!pre || writeBack)
+            cpu.r[rn] = moved;
+        setReg (rd, v);
+    }
+    else
+    {
+        uint32_t v = rd == 15 ? cpu.pc + 12 : cpu.r[rd];
+        store (address, byte ? v & 0xFF : v, byte ? 1 : 4);
+        if (!pre || writeBack)
+            cpu.r[rn] = moved;
+    }
+}
+
+static void halfTransfer (uint32_t insn)
+{
+    int rn = (insn >> 16) & 15, rd = (insn >> 12) & 15;
+    int pre = (insn >> 24) & 1, up = (insn >> 23) & 1;
+    int writeBack = (insn >> 21) & 1, isLoad = (insn >> 20) & 1;
+    int sh = (insn >> 5) & 3;
+    uint32_t offset = (insn & (1 << 22)) ? ((insn >> 4) & 0xF0) | (insn & 0xF) : cpu.r[insn & 15];
+    uint32_t base = reg (rn);
+    uint32_t moved = up ? base + offset : base - offset;
+    uint32_t address = pre ? moved : base;
+
+    if (isLoad)
+    {
+        uint32_t v;
+        if (sh == 1)
+            v = load16 (address);
+        else if (sh == 2)
+            v = (uint32_t)(int32_t)(int8)load8 (address);
+        else
+            v = (uint32_t)(int32_t)(int16_t)load16 (address);
+        cpu.cycles += 1;
+        if (!pre || writeBack)
+            cpu.r[rn] = moved;
+        setReg (rd, v);
+    }
+    else
+    {
+        store (address, (rd == 15 ? cpu.pc + 12 : cpu.r[rd]) & 0xFFFF, 2);
+        if (!pre || writeBack)
+            cpu.r[rn] = moved;
+    }
+}
+
+static void blockTransfer (uint32_t insn)
+{
+    int rn = (insn >> 16) & 15;
+    int pre = (insn >> 24) & 1, up = (insn >> 23) & 1, user = (insn >> 22) & 1;
+    int writeBack = (insn >> 21) & 1, isLoad = (insn >> 20) & 1;
+    uint32_t list = insn & 0xFFFF;
+    uint32_t base = cpu.r[rn];
+    int count = __builtin_popcount (list);
+    uint32_t address = up ? base : base - 4*count;
+    uint32_t end = up ? base + 4*count : base - 4*count;
+
+    if (pre == up)
+        address += 4;
+    int pcLoaded = isLoad && (list & 0x8000);
+    int userBank = user && !pcLoaded;
+
+    if (isLoad)
+    {
+        uint32_t pc = 0;
+        if (writeBack)
+            cpu.r[rn] = end;
+        for (int i = 0; i < 16; i++)
+            if (list & (1 << i))
+            {
+                uint32_t v = load32 (address);
+                address += 4;
+                if (i == 15)
+                    pc = v;
+                else if (userBank)
+                    *userReg (i) = v;
+                else
+                    cpu.r[i] = v;
+            }
+        cpu.cycles += 1;
+        if (pcLoaded)
+        {
+            if (user)
+            {
+                uint32_t spsr = cpu.spsr;
+                setCpsr (spsr);
+            }
+            setReg (15, pc);
+        }
+    }
+    else
+    {
+        int first = TRUE;
+        for (int i = 0; i < 16; i++)
+            if (list & (1 << i))
+            {
+                uint32_t v = i == 15 ? cpu.pc + 12 : userBank ? *userReg (i) : cpu.r[i];
+                if (i == rn && !first)
+                    v = end;
+                store (address, v, 4);
+                address += 4;
+                first = FALSE;
+            }
+        if (writeBack)
+            cpu.r[rn] = end;
+    }
+}
+
+static void execute (uint32_t insn)
+{
+    switch ((insn >> 25) & 7)
+    {
+        case 0:
+            if ((insn & 0x0FFFFFF0) == 0x012FFF10)
+            {
+                // BX
+                uint32_t target = cpu.r[insn & 15];
+                if (target & 1)
+                    fault ("Thumb state is not modelled, bx to", target);
+                setReg (15, target);
+            }
+            else if ((insn & 0x0FC000F0) == 0x00000090)
+                multiply (insn);
+            else if ((insn & 0x0F8000F0) == 0x00800090)
+                multiplyLong (insn);
+            else if ((insn & 0x0FB00FF0) == 0x01000090)
+            {
+                // SWP
+                int rn = (insn >> 16) & 15, byte = (insn >> 22) & 1;
+                uint32_t address = cpu.r[rn];
+                uint32_t v = byte ? load8 (address) : load32 (address);
+                store (address, cpu.r[insn & 15] & (byte ? 0xFF : 0xFFFFFFFF), byte ? 1 : 4);
+                cpu.r[(insn >> 12) & 15] = v;
+                cpu.cycles += 1;
+            }
+            else if ((insn & 0x0E000090) == 0x00000090)
+                halfTransfer (insn);
+            else if ((insn & 0x0F900000) == 0x01000000)
+                psrTransfer (insn);
+            else
+                dataProcessing (insn);
+            break;
+        case 1:
+            if ((insn & 0x0F900000) == 0x03000000)
+                psrTransfer (insn);
+            else
+                dataProcessing (insn);
+            break;
+        case 2:
+            singleTransfer (insn);
+            break;
+        case 3:
+            if (insn & 0x10)
+                fault ("undefined instruction", insn);
+            singleTransfer (insn);
+            break;
+        case 4:
+            blockTransfer (insn);
+            break;
+        case 5:
+        {
+            int32_t offset = (int32_t)(insn << 8) >> 6;
+            if (insn & (1 << 24))
+                cpu.r[14] = cpu.pc + 4;
+            setReg (15, cpu.pc + 8 + offset);
+            break;
+        }
+        case 6:
+            fault ("coprocessor instruction", insn);
+            break;
+        default:
+            if (insn & (1 << 24))
+                exception (MODE_SVC, 0x08, cpu.pc + 4, PSR_I);
+            else
+                fault ("coprocessor instruction", insn);
+            break;
+    }
+}
+
+/* Runs until the PC reaches stop or the cycle count reaches limit */
+static int run (uint32_t stop, unsigned long long limit)
+{
+    while (cpu.r[15] != stop)
+    {
+        if (limit && issStats.cycles >= limit)
+            return FALSE;
+
+        if (cpu.sleeping)
+        {
+            // The clock restarts on an interrupt, masked in the CPSR or not
+            if (!aicFiq () && aicIrq () < 0)
+            {
+                unsigned long long next = 0;
+                for (int n = 0; n < 3; n++)
+                {
+                    unsigned long long t = tcNext (n, TRUE);
+                    if (t && (next == 0 || t < next))
+                        next = t;
+                }
+                if (next == 0)
+                    fault ("asleep with no interrupt to come, pc", cpu.r[15]);
+                if (limit && next > limit)
+                    next = limit;
+                issStats.sleeping += next - issStats.cycles;
+                issStats.cycles = next;
+                continue;
+            }
+            cpu.sleeping = FALSE;
+            pmcScsr |= AT91C_PMC_PCK;
+            linesDue = 0;
+        }
+        if (issStats.cycles >= linesDue)
+            updateLines ();
+
+        cpu.cycles = 0;
+        cpu.pc = cpu.r[15];
+        if (!(cpu.cpsr & PSR_F) && fiqLine)
+        {
+            // The fetch that is abandoned, then the vector
+            cpu.cycles += cpu.pc >= SRAM_BASE ? 1 : flashCycles ();
+            issStats.interrupts++;
+            exception (MODE_FIQ, 0x1C, cpu.pc + 4, PSR_I | PSR_F);
+        }
+        else if (!(cpu.cpsr & PSR_I) && irqLine)
+        {
+            cpu.cycles += cpu.pc >= SRAM_BASE ? 1 : flashCycles ();
+            issStats.interrupts++;
+            exception (MODE_IRQ, 0x18, cpu.pc + 4, PSR_I);
+        }
+        else
+        {
+            uint32_t insn = fetch (cpu.pc);
+            cpu.r[15] = cpu.pc + 4;
+            issStats.instructions++;
+            if (condition (insn))
+                execute (insn);
+        }
+        issStats.cycles += cpu.cycles;
+    }
+    return TRUE;
+}
+
+/* --- Loading and calling ------------------------------------------- */
+
+static uint32_t le32 (const uint8 *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t le16 (const uint8 *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+int issLoad (const char *name)
+{
+    FILE *f = fopen (name, "rb");
+    uint8 *elf;
+    long size;
+
+    if (f == NULL)
+    {
+        perror (name);
+        return FALSE;
+    }
+    fseek (f, 0, SEEK_END);
+    size = ftell (f);
+    rewind (f);
+    elf = malloc (size);
+    if (elf == NULL || fread (elf, 1, size, f) != (size_t)size)
+    {
+        perror (name);
+        fclose (f);
+        return FALSE;
+    }
+    fclose (f);
+
+    if (size < 52 || memcmp (elf, "\177ELF\1\1", 6) != 0 || le16 (elf + 18) != 40)
+    {
+        fprintf (stderr, "%s: not a 32 bit little endian ARM executable\n", name);
+        free (elf);
+        return FALSE;
+    }
+
+    // Program headers: everything that is loaded goes into the flash
+    memset (image, 0xFF, sizeof(image));
+    uint32_t phoff = le32 (elf + 28), phnum = le16 (elf + 44), phsize = le16 (elf + 42);
+    for (uint32_t i = 0; i < phnum; i++)
+    {
+        const uint8 *ph = elf + phoff + i * phsize;
+        uint32_t offset = le32 (ph + 4), paddr = le32 (ph + 12), filesz = le32 (ph + 16);
+        if (le32 (ph) != 1 || filesz == 0)
+            continue;
+        if (paddr + filesz > FLASH_SIZE || offset + filesz > (uint32_t)size)
+        {
+            fprintf (stderr, "%s: segment at %08X is not in the flash\n", name, paddr);
+            free (elf);
+            return FALSE;
+        }
+        memcpy (image + paddr, elf + offset, filesz);
+    }
+
+    // The symbol table, for issSymbol()
+    uint32_t shoff = le32 (elf + 32), shnum = le16 (elf + 48), shsize = le16 (elf + 46);
+    for (uint32_t i = 0; i < shnum; i++)
+    {
+        const uint8 *sh = elf + shoff + i * shsize;
+        if (le32 (sh + 4) != 2)
+            continue;
+        const uint8 *strtab = elf + le32 (elf + shoff + le32 (sh + 24) * shsize + 16);
+        uint32_t count = le32 (sh + 20) / 16;
+        symbols = realloc (symbols, (symbolCount + count) * sizeof(*symbols));
+        for (uint32_t n = 0; n < count; n++)
+        {
+            const uint8 *sym = elf + le32 (sh + 16) + n * 16;
+            const char *symName = (const char *)strtab + le32 (sym);
+            if (*symName == '\0' || *symName == '$')
+                continue;
+            symbols[symbolCount].name = strdup (symName);
+            symbols[symbolCount].value = le32 (sym + 4);
+            symbolCount++;
+        }
+    }
+    free (elf);
+    if (issSymbol ("main") == 0)
+    {
+        fprintf (stderr, "%s: no main()\n", name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+uint32_t issSymbol (const char *name)
+{
+    for (unsigned i = 0; i < symbolCount; i++)
+        if (strcmp (symbols[i].name, name) == 0)
+            return symbols[i].value;
+    return 0;
+}
+
+void issBoot (void)
+{
+    uint32_t pattern = STACK_PAINT;
+
+    memcpy (flash, image, sizeof(flash));
+    for (uint32_t i = 0; i < SRAM_SIZE; i += 4)
+        memcpy (&sram[i], &pattern, 4);
+    memset (&cpu, 0, sizeof(cpu));
+    memset (&tc, 0, sizeof(tc));
+    memset (&aic, 0, sizeof(aic));
+    memset (&spi, 0, sizeof(spi));
+    memset (&hostPIOA, 0, sizeof(hostPIOA));
+    mcFmr = 0;
+    pmcScsr = AT91C_PMC_PCK;
+    waitingOn = FALSE;
+    linesDue = 0;
+
+    cpu.cpsr = MODE_SVC | PSR_I | PSR_F;
+    cpu.r[15] = 0;
+    memset (&issStats, 0, sizeof(issStats));
+    run (issSymbol ("main"), 0);
+}
+
+int issCall (uint32_t function, const uint32_t *args, int argc,
+        unsigned long long limit, uint32_t *result)
+{
+    static uint32_t stack;
+
+    // main()'s stack pointer, as crt.s left it
+    if (stack == 0 || cpu.r[15] == issSymbol ("main"))
+        stack = cpu.r[13];
+    // 8 byte aligned, as the AAPCS has it at a call; crt.s leaves main()'s
+    // stack only word aligned
+    cpu.r[13] = stack & ~7;
+    // Arguments after the fourth on the stack, which stays 8 byte aligned
+    if (argc > 4)
+        cpu.r[13] -= (4*(argc - 4) + 7) & ~7;
+    for (int i = 0; i < argc; i++)
+        if (i < 4)
+            cpu.r[i] = args[i];
+        else
+            issWrite (cpu.r[13] + 4*(i - 4), &args[i], 4);
+    cpu.r[14] = ISS_RETURN;
+    cpu.r[15] = function;
+    cpu.sleeping = FALSE;
+    return issResume (limit, result);
+}
+
+int issResume (unsigned long long limit, uint32_t *result)
+{
+    if (!run (ISS_RETURN, limit ? issStats.cycles + limit : 0))
+        return FALSE;
+    if (result)
+        *result = cpu.r[0];
+    return TRUE;
+}
+
+/* A byte of SRAM or flash for the host, never a peripheral */
+static uint8 *byteAt (uint32_t address)
+{
+    uint8 *p = memory (address);
+    if (p == NULL)
+        fault ("host access to a peripheral,", address);
+    return p;
+}
+
+void issWrite (uint32_t address, const void *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        *byteAt (address + i) = ((const uint8 *)data)[i];
+}
+
+void issRead (uint32_t address, void *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+        ((uint8 *)data)[i] = *byteAt (address + i);
+}
+
+uint32_t issStackUsed (uint32_t top, uint32_t size)
+{
+    uint32_t used = size;
+    uint32_t pattern = STACK_PAINT;
+
+    // The deepest word that no longer holds the pattern
+    for (uint32_t a = top - size; a < top; a += 4, used -= 4)
+        if (memcmp (&sram[a & (SRAM_SIZE-1)], &pattern, 4) != 0)
+            break;
+    return used;
+}
@@ -0,0 +1,65 @@
+/*
+ * iss.h
+ *
+ * ARM7TDMI instruction set simulator for the firmware image, so the
+ * cross-compiled code can be timed on the host: the same main.elf that goes
+ * into the flash is loaded and its functions are called by name. The core
+ * runs ARM state only, with the cycle counts of the ARM7TDMI manual and the
+ * AT91SAM7S256 memory timing, see iss.c.
+ *
+ * The PIOA's LCD pins go to the ST7529 emulation (st7529.h), as do the
+ * words the SPI's PDC channel sends, paced by the SPI clock. TC0-TC2, the
+ * AIC and the processor clock (PMC_SCDR) are modelled far enough for the
+ * frame tick and busyWait(); other peripherals read as ready.
+ *
+ * Target words are uint32_t rather than uint32, which is 64 bits on an
+ * LP64 host.
+ *
+ * John Howe 2010
+ */
+
+#ifndef ISS_H
+#define ISS_H
+
+#include <stdint.h>
+#include "config.h"
+
+typedef struct {
+    unsigned long long cycles;          // MCK cycles since issBoot()
+    unsigned long long instructions;
+    unsigned long long waiting;         // polling an SPI or PDC that was not ready
+    unsigned long long sleeping;        // processor clock stopped (PMC_SCDR)
+    unsigned long interrupts;           // IRQs and FIQs taken
+} issStats_t;
+
+extern issStats_t issStats;
+
+/* Read a firmware image. Returns FALSE, with a message, if it is not an
+ * ARM executable. */
+int issLoad (const char *elf);
+
+/* The address of a symbol of the image, 0 if there is none */
+uint32_t issSymbol (const char *name);
+
+/* Reset the board and run the startup code (crt.s) up to main(). Every
+ * stack is filled with a pattern first, for issStackUsed(). */
+void issBoot (void);
+
+/* Call a function of the image on main()'s stack, until it returns or
+ * limit more cycles have run (0 for no limit). Returns TRUE if it
+ * returned, with its result in *result if not NULL. */
+int issCall (uint32_t function, const uint32_t *args, int argc,
+        unsigned long long limit, uint32_t *result);
+
+/* Carry on with a call that ran out of cycles, the same way */
+int issResume (unsigned long long limit, uint32_t *result);
+
+/* Target memory, for arguments and results: SRAM or flash */
+void issWrite (uint32_t address, const void *data, uint32_t length);
+void issRead (uint32_t address, void *data, uint32_t length);
+
+/* Bytes of the stack below top, size bytes long, that have been written
+ * since issBoot() */
+uint32_t issStackUsed (uint32_t top, uint32_t size);
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * lcdstream.c
+ *
+ * Host version of the RAM resident ARM kernels in ../lcdstream.s
+ *
+ * John Howe 2010
+ */
+
+#include "lcd.h"
+
+#if !defined(BUS_SPI) && !defined(BUS_LEGACY)
+
+void streamPixels (const uint8 *pixels, uint16 count)
+{
+    while (count--)
+        burstWrite (*pixels++);
+}
+
+void burstFill (uint8 data, uint16 count)
+{
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    uint32 out = pixelTable[data];
+    while (count--)
+    {
+        PIO_WRITE (pPIO->PIO_ODSR, out);
+        PIO_WRITE (pPIO->PIO_ODSR, out ^ (PWR | PRD));
+    }
+}
+
+#endif
@@ -0,0 +1,667 @@
+/*
+ * main.c
+ *
+ * Host build of the SLM firmware. Runs the frame receivers against a file
+ * or pipe, or draws one of the test patterns, on an emulated ST7529 (see
+ * st7529.h) and reports the sustained frame rate and the bus traffic, and
+ * the time the bus would take on the ARM (host/spi.c). "make host BUS=spi"
+ * builds it for the SPI back-end.
+ *
+ *   slmhost [-u] [-f shown] [-p panel] [-d pattern [-n count]]
+ *           [-s store [-n count]] [-w store] [-k curve] [-g pwm] [-t trace]
+ *           [-a x,y,r | -a x0,y0,x1,y1] [-z w0,w1,...] [-b]
+ *           [-l telemetry] [file]
+ *
+ *   file   link data to receive, default stdin
+ *   -u     receive through the simulated USART0/PDC at USART_BAUD instead
+ *          of USB, and report the frame rate the serial link would allow
+ *   -f     write the frame left on display (the framebuffer) to shown, in
+ *          RAMWR order, to check the decoders against the frames sent
+ *   -p     write the emulated panel to panel as a PGM image
+ *   -d     draw pattern (erase, slide, waves, frame, turbulence or zernike)
+ *          count times (1)
+ *          instead of receiving frames, to measure the drawing code
+ *   -s     load a sequence store image (tools/slmlink/slmpack) and play
+ *          each sequence in it count times (1) instead of receiving frames
+ *   -k     load the calibration curve in the text file curve (GRAY_LEVELS
+ *          gray codes, as for slmsend -k), check that every pixel byte
+ *          reaches the panel through it on each burst path, then run
+ *          with it loaded
+ *   -g     send the gray PWM table in the text file pwm (GRAY_PARAMS
+ *          widths for GRAY1, then GRAY_PARAMS for GRAY2) as a FORMAT_GRAY
+ *          frame, check the command bytes on the bus and the tables the
+ *          controller ended up with, then run with it selected
+ *   -a     draw only inside a circular (centre and radius) or rectangular
+ *          (inclusive corners) aperture, in pixels
+ *   -z     weights of the Zernike terms for -d zernike, in waves and in
+ *          the order of zernike.h (default some of each aberration), then
+ *          check every pixel drawn against evaluating the polynomial
+ *          directly and against the terms in floating point
+ *   -b     check the bus word for every byte (busWord(), from table[] or
+ *          the BUS_SHIFT shift) against placing its bits one at a time on
+ *          the pins in config.h, as the table used to be built at boot,
+ *          and that each byte written reaches the emulated controller
+ *   -l     start the DBGU telemetry (telemetry.h) and write what it
+ *          sends to telemetry; with "make host HOSTDEFS=-DPROFILE" that is
+ *          the profile (profile.h), which is also printed at the end, in
+ *          the model's cycles (bus time only, see host.h)
+ *   -t     decode the bus into trace, one command or parameter per line
+ *   -w     write the sequence store to store afterwards, to check the
+ *          pages programmed over the link
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "lcd.h"
+#include "frame.h"
+#include "usb.h"
+#include "usart.h"
+#include "animate.h"
+#include "st7529.h"
+#include "seqstore.h"
+#include "aperture.h"
+#include "zernike.h"
+#include "telemetry.h"
+#include "profile.h"
+
+AT91S_PIO hostPIOA;
+extern FILE *hostLink;
+extern FILE *hostTelemetry;
+
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Feeds the input through the simulated USART, polling the driver as
+ * often as the firmware would. Returns the time the data takes on the wire. */
+static double usartRun (void)
+{
+    unsigned long bytes = 0, overruns = 0;
+    int c;
+
+    initUSART ();
+    while ((c = fgetc (hostLink)) != EOF)
+    {
+        if (!hostUsartReceive (c))
+            overruns++;
+        if (++bytes % (USART_CHUNK/2) == 0)
+            pollUSART ();
+    }
+    hostUsartIdle ();
+    pollUSART ();
+
+    double seconds = bytes * 10.0 / USART_BAUD; // 8N1
+    printf ("bytes     %lu\n", bytes);
+    printf ("overruns  %lu\n", overruns);
+    printf ("link s    %.3f at %d baud\n", seconds, USART_BAUD);
+    if (seconds > 0)
+        printf ("link f/s  %.2f\n", linkStats.frames / seconds);
+    return seconds;
+}
+
+static int writeShown (const char *name)
+{
+    FILE *f = fopen (name, "wb");
+    if (f == NULL)
+    {
+        perror (name);
+        return 1;
+    }
+    for (int y = 0; y < LCD_HEIGHT; y++)
+        for (int x = 0; x < LCD_WIDTH; x++)
+            fputc (getPixel (x, y) << 3, f);
+    fclose (f);
+    return 0;
+}
+
+static int writePanel (const char *name)
+{
+    FILE *f = fopen (name, "wb");
+    if (f == NULL || !writePGM (f))
+    {
+        perror (name);
+        return 1;
+    }
+    fclose (f);
+    return 0;
+}
+
+static int loadStore (const char *name)
+{
+    FILE *f = fopen (name, "rb");
+    if (f == NULL)
+    {
+        perror (name);
+        return FALSE;
+    }
+    memset (hostStore, 0xFF, STORE_SIZE); // erased flash
+    size_t n = fread (hostStore, 1, STORE_SIZE, f);
+    fclose (f);
+    if (n == 0 || storeSequences () == 0)
+    {
+        fprintf (stderr, "%s: not a sequence store\n", name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int writeStore (const char *name)
+{
+    FILE *f = fopen (name, "wb");
+    if (f == NULL || fwrite (hostStore, 1, STORE_SIZE, f) != STORE_SIZE)
+    {
+        perror (name);
+        return 1;
+    }
+    fclose (f);
+    return 0;
+}
+
+static int readCurve (const char *name, uint8 *curve)
+{
+    FILE *f = fopen (name, "r");
+    int level, gray;
+
+    if (f == NULL)
+    {
+        perror (name);
+        return FALSE;
+    }
+    for (level = 0; level < GRAY_LEVELS && fscanf (f, "%d", &gray) == 1; level++)
+        curve[level] = gray;
+    fclose (f);
+    if (level < GRAY_LEVELS)
+    {
+        fprintf (stderr, "%s: %d of %d levels\n", name, level, GRAY_LEVELS);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Sends all 256 pixel bytes through burstWrite(), burstFill() and
+ * streamPixels() in turn and compares what the emulated controller latched
+ * with the curve applied by hand. Returns the number of mismatches. */
+static unsigned checkCalibration (const uint8 *curve)
+{
+    static const char *paths[] = { "burstWrite", "burstFill", "streamPixels" };
+    static uint8 bytes[2*LCD_WIDTH];
+    unsigned bad = 0;
+
+    for (int i = 0; i < 2*LCD_WIDTH; i++)
+        bytes[i] = i;
+
+    for (int path = 0; path < 3; path++)
+    {
+        setWindow (0, 0, LCD_WIDTH/3-1, 1);
+        beginBurst ();
+        if (path == 2)
+            streamPixels (bytes, 2*LCD_WIDTH);
+        for (int i = 0; path < 2 && i < 2*LCD_WIDTH; i++)
+        {
+            if (path == 0)
+                burstWrite (bytes[i]);
+            else
+                burstFill (bytes[i], 1);
+        }
+        endBurst ();
+
+        for (int i = 0; i < 2*LCD_WIDTH; i++)
+        {
+            uint8 want = ((curve[bytes[i] >> 3] & (GRAY_LEVELS-1)) << 3) | (bytes[i] & 7);
+            uint8 got = gddram[i / LCD_WIDTH][i % LCD_WIDTH];
+            if (got != want && bad++ < 8)
+                fprintf (stderr, "%s: byte 0x%02X sent as 0x%02X, expected 0x%02X\n",
+                        paths[path], bytes[i], got, want);
+        }
+    }
+    printf ("calibration %s (%u mismatches)\n", bad ? "FAILED" : "ok", bad);
+    return bad;
+}
+
+/* Receives the table through the link into GRAY_SLOTS-1 and checks the
+ * decoded bus bytes against the sequence the datasheet asks for. Returns
+ * the number of mismatches. */
+static unsigned checkGrayPWM (const grayPWM_t *pwm)
+{
+    uint8 frame[LINK_HEADER + 1 + sizeof(grayPWM_t)] = {
+        LINK_SYNC0, LINK_SYNC1, FORMAT_GRAY, 0, sizeof(frame) - LINK_HEADER, 0, GRAY_SLOTS-1
+    };
+    char expected[40*5 + 1], *e = expected;
+    char *got = NULL;
+    size_t length;
+    unsigned bad = 0;
+
+    memcpy (frame + LINK_HEADER + 1, pwm, sizeof(grayPWM_t));
+    e += sprintf (e, "C %02X\nC %02X\n", EXTOUT, GRAY1);
+    for (int i = 0; i < GRAY_PARAMS; i++)
+        e += sprintf (e, "D %02X\n", pwm->frame1[i]);
+    e += sprintf (e, "C %02X\n", GRAY2);
+    for (int i = 0; i < GRAY_PARAMS; i++)
+        e += sprintf (e, "D %02X\n", pwm->frame2[i]);
+    sprintf (e, "C %02X\n", EXTIN);
+
+    FILE *bus = open_memstream (&got, &length);
+    unsigned long stores = busStats.stores;
+    st7529Trace (bus);
+    parseLink (frame, sizeof(frame));
+    st7529Trace (NULL);
+    fclose (bus);
+    stores = busStats.stores - stores;
+
+    if (strcmp (got, expected) != 0)
+    {
+        fprintf (stderr, "gray PWM bus bytes:\n%sexpected:\n%s", got, expected);
+        bad++;
+    }
+    if (memcmp (st7529Gray (1), pwm->frame1, GRAY_PARAMS) != 0)
+        bad++;
+    if (memcmp (st7529Gray (2), pwm->frame2, GRAY_PARAMS) != 0)
+        bad++;
+    if (st7529Ext () != 0)
+        bad++;
+    if (linkStats.errors)
+        bad++;
+    free (got);
+
+    printf ("gray PWM %s (%u mismatches, %lu stores to switch tables)\n",
+            bad ? "FAILED" : "ok", bad, stores);
+    return bad;
+}
+
+/* The terms of zernike.h at (u, v), in floating point */
+static double zernikeTerm (int term, double u, double v)
+{
+    double r2 = u*u + v*v;
+    switch (term)
+    {
+        case ZERNIKE_PISTON:    return 1;
+        case ZERNIKE_TILT_X:    return u;
+        case ZERNIKE_TILT_Y:    return v;
+        case ZERNIKE_DEFOCUS:   return 2*r2 - 1;
+        case ZERNIKE_ASTIG_0:   return u*u - v*v;
+        case ZERNIKE_ASTIG_45:  return 2*u*v;
+        case ZERNIKE_COMA_X:    return (3*r2 - 2) * u;
+        case ZERNIKE_COMA_Y:    return (3*r2 - 2) * v;
+        case ZERNIKE_SPHERICAL: return 6*r2*r2 - 6*r2 + 1;
+    }
+    return 0;
+}
+
+/* Checks the pixels drawZernike() left inside the aperture. They must match
+ * the polynomial evaluated directly exactly, and the shade worked out in
+ * floating point except where rounding the weights moves a wrap. */
+static unsigned checkZernike (const int16 *weights)
+{
+    unsigned bad = 0, rounded = 0, pixels = 0;
+    double worst = 0;
+
+    for (int y = 0; y < LCD_HEIGHT; y++)
+    {
+        for (int x = 3*spans[y].startCol; x < 3*spans[y].endCol; x++)
+        {
+            long long phase = zernikePhase (x, y);
+            if (gddram[y][x] != ZERNIKE_SHADE (phase) << 3)
+                bad++;
+
+            // The default pupil
+            double u = (x - LCD_WIDTH/2) / (double)(LCD_HEIGHT/2);
+            double v = (y - LCD_HEIGHT/2) / (double)(LCD_HEIGHT/2);
+            double exact = 0;
+            for (int t = 0; t < ZERNIKE_TERMS; t++)
+                exact += weights[t] * zernikeTerm (t, u, v) / ZERNIKE_WAVE;
+            double error = fabs (exact - phase / (double)(1LL << ZERNIKE_SHIFT));
+            if (error > worst)
+                worst = error;
+            int shade = ((int)floor (32*exact) % 32 + 32) % 32;
+            if (gddram[y][x] >> 3 != shade)
+                rounded++;
+            pixels++;
+        }
+    }
+
+    printf ("zernike   %s (%u of %u pixels off the direct evaluation, %u shades off floating point, worst %.2g waves)\n",
+            bad ? "FAILED" : "ok", bad, pixels, rounded, worst);
+    return bad;
+}
+
+static int16 zernikeWeights[ZERNIKE_TERMS] = {
+    [ZERNIKE_DEFOCUS] = ZERNIKE_WAVE,
+    [ZERNIKE_ASTIG_0] = ZERNIKE_WAVE/2,
+    [ZERNIKE_COMA_X] = ZERNIKE_WAVE/2,
+    [ZERNIKE_SPHERICAL] = ZERNIKE_WAVE/4,
+};
+
+/* Checks busWord() for all 256 bytes against the bit by bit encoding, and
+ * that write() delivers each byte to the controller */
+static unsigned checkBusWords (void)
+{
+    static const uint32 pins[8] = { PD0, PD1, PD2, PD3, PD4, PD5, PD6, PD7 };
+    unsigned bad = 0;
+
+    for (unsigned b = 0; b < 256; b++)
+    {
+        uint32 expected = PRD;
+        for (int bit = 0; bit < 8; bit++)
+            if (b & (1 << bit))
+                expected |= pins[bit];
+        if (busWord (b) != expected)
+            bad++;
+    }
+
+    // CASET's parameters are latched as they are, any value will do
+    char *got;
+    size_t length;
+    FILE *bus = open_memstream (&got, &length);
+    st7529Trace (bus);
+    write (COMMAND, CASET);
+    for (unsigned b = 0; b < 256; b++)
+        write (DATA, b);
+    st7529Trace (NULL);
+    fclose (bus);
+    const char *line = got;
+    for (int n = -1; n < 256; n++)
+    {
+        unsigned value;
+        char kind;
+        if (sscanf (line, "%c %x", &kind, &value) != 2 ||
+                kind != (n < 0 ? 'C' : 'D') || value != (n < 0 ? CASET : (unsigned)n))
+            bad++;
+        line = strchr (line, '\n');
+        if (line == NULL)
+            break;
+        line++;
+    }
+    free (got);
+
+    printf ("bus words %s (%u mismatches, %s)\n", bad ? "FAILED" : "ok", bad,
+#ifdef BUS_SHIFT
+            "shift"
+#elif defined(BUS_TABLE_RAM)
+            "table in SRAM"
+#else
+            "table in flash"
+#endif
+            );
+    return bad;
+}
+
+#ifdef PROFILE
+/* The profile since the last report (BUS_SPI) or the start, as
+ * profileReport() would send it */
+static void printProfile (void)
+{
+    printf ("profile   %s, in MCK cycles of bus time\n",
+#ifdef BUS_SPI
+            "since the last report"
+#else
+            "since the start"
+#endif
+            );
+    for (int point = 0; point < PROFILE_POINTS; point++)
+    {
+        profile_t *p = &profiles[point];
+        printf ("  %-6s n %lu", profileNames[point], (unsigned long)p->count);
+        if (p->count)
+        {
+            printf (" min %lu mean %llu max %lu bins", (unsigned long)p->min,
+                    p->total / p->count, (unsigned long)p->max);
+            int used = PROFILE_BINS;
+            while (used && p->bins[used-1] == 0)
+                used--;
+            for (int i = 0; i < used; i++)
+                printf (" %u", p->bins[i]);
+        }
+        printf ("\n");
+    }
+}
+#endif
+
+void slide (uint8 aperture, uint8 steps, uint8 front, uint8 direction);
+void drawWaves (uint8 wavelength, uint8 wavefront, uint8 direction);
+void drawTurbulence (uint32 seed);
+
+/* Draws one test pattern, returns FALSE if there is no such pattern */
+static int drawPattern (const char *pattern)
+{
+    if (strcmp (pattern, "erase") == 0)
+        eraseDisplay ();
+    else if (strcmp (pattern, "slide") == 0)
+        slide (APERTURE, MAX_STEPS, 0, rising);
+    else if (strcmp (pattern, "waves") == 0)
+        drawWaves (WAVELENGTH, 0, rising);
+    else if (strcmp (pattern, "turbulence") == 0)
+        drawTurbulence (1);
+    else if (strcmp (pattern, "zernike") == 0)
+    {
+        setZernike (zernikeWeights);
+        drawZernike ();
+    }
+    else if (strcmp (pattern, "frame") == 0)
+    {
+        clearFrame (0);
+        for (int i = 0; i < 8; i++)
+            fillRect (i*30, i*20, i*30 + 29, i*20 + 19, i*4 + 3);
+        flushFrame ();
+    }
+    else
+        return FALSE;
+    return TRUE;
+}
+
+int main (int argc, char **argv)
+{
+    int serial = FALSE;
+    const char *shown = NULL;
+    const char *panel = NULL;
+    const char *pattern = NULL;
+    const char *store = NULL;
+    const char *storeOut = NULL;
+    const char *curveName = NULL;
+    uint8 curve[GRAY_LEVELS];
+    const char *pwmName = NULL;
+    grayPWM_t pwm;
+    FILE *trace = NULL;
+    const char *aperture = NULL;
+    unsigned long count = 1;
+    int busCheck = FALSE;
+    int arg = 1;
+
+    for (; arg < argc; arg++)
+    {
+        if (strcmp (argv[arg], "-u") == 0)
+            serial = TRUE;
+        else if (strcmp (argv[arg], "-b") == 0)
+            busCheck = TRUE;
+        else if (strcmp (argv[arg], "-f") == 0 && arg + 1 < argc)
+            shown = argv[++arg];
+        else if (strcmp (argv[arg], "-p") == 0 && arg + 1 < argc)
+            panel = argv[++arg];
+        else if (strcmp (argv[arg], "-d") == 0 && arg + 1 < argc)
+            pattern = argv[++arg];
+        else if (strcmp (argv[arg], "-s") == 0 && arg + 1 < argc)
+            store = argv[++arg];
+        else if (strcmp (argv[arg], "-k") == 0 && arg + 1 < argc)
+            curveName = argv[++arg];
+        else if (strcmp (argv[arg], "-g") == 0 && arg + 1 < argc)
+            pwmName = argv[++arg];
+        else if (strcmp (argv[arg], "-a") == 0 && arg + 1 < argc)
+            aperture = argv[++arg];
+        else if (strcmp (argv[arg], "-z") == 0 && arg + 1 < argc)
+        {
+            char *w = argv[++arg];
+            for (int t = 0; t < ZERNIKE_TERMS; t++)
+            {
+                zernikeWeights[t] = lround (strtod (w, &w) * ZERNIKE_WAVE);
+                if (*w == ',')
+                    w++;
+            }
+        }
+        else if (strcmp (argv[arg], "-t") == 0 && arg + 1 < argc)
+        {
+            if ((trace = fopen (argv[++arg], "w")) == NULL)
+            {
+                perror (argv[arg]);
+                return 1;
+            }
+        }
+        else if (strcmp (argv[arg], "-l") == 0 && arg + 1 < argc)
+        {
+            if ((hostTelemetry = fopen (argv[++arg], "w")) == NULL)
+            {
+                perror (argv[arg]);
+                return 1;
+            }
+        }
+        else if (strcmp (argv[arg], "-w") == 0 && arg + 1 < argc)
+            storeOut = argv[++arg];
+        else if (strcmp (argv[arg], "-n") == 0 && arg + 1 < argc)
+            count = strtoul (argv[++arg], NULL, 0);
+        else
+            break;
+    }
+    if (arg < argc && (hostLink = fopen (argv[arg], "rb")) == NULL)
+    {
+        perror (argv[arg]);
+        return 1;
+    }
+    if (hostLink == NULL)
+        hostLink = stdin;
+    memset (hostStore, 0xFF, STORE_SIZE);
+    if (store && !loadStore (store))
+        return 1;
+
+#ifndef BUS_LEGACY
+    // The PIO set up done by InitController()
+    PIO_WRITE (AT91C_BASE_PIOA->PIO_OWER, BUS_MASK);
+#endif
+    st7529Trace (trace);
+    initLCD ();
+    if (busCheck && checkBusWords ())
+        return 1;
+    if (curveName)
+    {
+        if (!readCurve (curveName, curve))
+            return 1;
+        loadCalibration (curve);
+        if (checkCalibration (curve))
+            return 1;
+    }
+    if (aperture)
+    {
+        int a[4];
+        int n = sscanf (aperture, "%d,%d,%d,%d", &a[0], &a[1], &a[2], &a[3]);
+        if (n == 3)
+            apertureCircle (a[0], a[1], a[2]);
+        else if (n == 4)
+            apertureRect (a[0], a[1], a[2], a[3]);
+        else
+        {
+            fprintf (stderr, "%s: aperture %s is not x,y,r or x0,y0,x1,y1\n", argv[0], aperture);
+            return 2;
+        }
+        printf ("aperture  %u of %u groups in %u windows\n",
+                apertureGroups (), LCD_WIDTH/3*LCD_HEIGHT, bandCount);
+    }
+    if (pwmName)
+    {
+        // Same text format as the curve: GRAY_LEVELS values 0-31
+        if (!readCurve (pwmName, (uint8 *)&pwm))
+            return 1;
+        if (checkGrayPWM (&pwm))
+            return 1;
+        st7529Trace (trace);
+    }
+    if (hostTelemetry && !initTelemetry ())
+        printf ("telemetry off: DTXD is LCD D4 on the parallel bus\n");
+    memset (&busStats, 0, sizeof(busStats));
+    hostBusStart ();
+#ifdef PROFILE
+    profileClear ();
+#endif
+
+    double start = now ();
+    unsigned long frames;
+    if (pattern)
+    {
+        for (frames = 0; frames < count; frames++)
+        {
+            if (!drawPattern (pattern))
+            {
+                fprintf (stderr, "%s: no pattern %s\n", argv[0], pattern);
+                return 2;
+            }
+            nextFrame ();
+        }
+    }
+    else if (store)
+    {
+        for (uint8 i = 0; i < storeSequences (); i++)
+        {
+            if (!playSequence (i, count))
+            {
+                fprintf (stderr, "%s: sequence %d is damaged\n", store, i);
+                return 1;
+            }
+        }
+        frames = linkStats.frames;
+        printf ("sequences %d\n", storeSequences ());
+        printf ("frames    %lu\n", frames);
+        printf ("errors    %lu\n", (unsigned long)linkStats.errors);
+    }
+    else
+    {
+        if (serial)
+            usartRun ();
+        else
+            usbLoop ();
+        frames = linkStats.frames;
+        printf ("frames    %lu\n", frames);
+        printf ("dropped   %lu\n", (unsigned long)linkStats.dropped);
+        printf ("errors    %lu\n", (unsigned long)linkStats.errors);
+        if (linkStats.pages)
+            printf ("pages     %lu\n", (unsigned long)linkStats.pages);
+    }
+    double elapsed = now () - start;
+
+    printf ("seconds   %.3f\n", elapsed);
+    if (elapsed > 0)
+        printf ("frames/s  %.1f\n", frames / elapsed);
+    printf ("stores    %lu\n", busStats.stores);
+    printf ("bus bytes %lu (%lu commands, %lu RAMWR)\n",
+            busStats.bytes, busStats.commands, busStats.pixels);
+    if (frames)
+        printf ("per frame %.1f stores, %.1f bytes\n",
+                (double)busStats.stores / frames, (double)busStats.bytes / frames);
+    hostBusModel (frames);
+#ifdef PROFILE
+    printProfile ();
+#endif
+    if (hostTelemetry)
+    {
+        hostDbguTransmit ();
+        pollTelemetry ();
+        printf ("telemetry %lu bytes sent, %lu dropped\n",
+                (unsigned long)telemetryStats.sent, (unsigned long)telemetryStats.dropped);
+    }
+
+    int status = 0;
+    if (pattern && strcmp (pattern, "zernike") == 0 && checkZernike (zernikeWeights))
+        status = 1;
+    if (shown)
+        status |= writeShown (shown);
+    if (panel)
+        status |= writePanel (panel);
+    if (storeOut)
+        status |= writeStore (storeOut);
+    if (trace)
+        fclose (trace);
+    return status;
+}
@@ -0,0 +1,115 @@
+/*
+ * spi.c
+ *
+ * Host model of the SPI and its PDC channel for the serial back-end
+ * (../lcdspi.c), and the timing model both back-ends are compared with.
+ *
+ * Time is kept in MCK cycles of the bus alone (hostCycles, see host.h):
+ * each parallel bus store takes PIO_CYCLES, and the SPI shifts
+ * 9*SPI_DIVIDER cycles per word. A buffer queued with TNCR is sent as soon
+ * as the one ahead of it is done, and the driver's wait for TNCR to clear
+ * moves the clock on to when that happens, so the register reads 0 by the
+ * time the driver looks. Commands through SPI_TDR wait for the SPI to go
+ * idle.
+ *
+ * The code is not timed, so this is what the bus needs per frame, a floor
+ * under the frame time rather than a measure of it. The CPU's busy, waiting
+ * and free time per frame are measured on the simulator by "make bench"
+ * (bench.c). For BUS=spi the SPCK the frames need to fit the period is
+ * printed too.
+ *
+ * John Howe 2010
+ */
+
+#include <stddef.h>
+#include "lcd.h"
+#include "st7529.h"
+
+AT91S_SPI hostSPI;
+
+#ifdef BUS_SPI
+#define WORD_CYCLES     (9*SPI_DIVIDER)
+
+static unsigned long busyUntil; // cycle the SPI finishes what it was given
+static unsigned long words;
+
+static uint16 *resolve (AT91_REG address)
+{
+    for (int i = 0; i < 2; i++)
+        if ((AT91_REG)(unsigned long)spiBuffer[i] == address)
+            return spiBuffer[i];
+    return NULL;
+}
+
+/* The driver waits until cycle until */
+static void stall (unsigned long until)
+{
+    if (until > hostCycles)
+        hostCycles = until;
+}
+
+static void send (uint16 word)
+{
+    words++;
+    st7529Serial (word);
+}
+#endif
+
+void hostSpiWrite (volatile unsigned int *reg, unsigned int value)
+{
+    *reg = value;
+#ifdef BUS_SPI
+    hostSPI.SPI_SR |= AT91C_SPI_TXBUFE | AT91C_SPI_TDRE | AT91C_SPI_TXEMPTY;
+
+    if (reg == &hostSPI.SPI_TNCR && value)
+    {
+        uint16 *p = resolve (hostSPI.SPI_TNPR);
+        if (p == NULL)
+            return;
+
+        // Taken by the PDC once the buffer ahead has gone
+        stall (busyUntil);
+        if (busyUntil < hostCycles)
+            busyUntil = hostCycles;
+        busyUntil += value * WORD_CYCLES;
+        while (value--)
+            send (*p++);
+        hostSPI.SPI_TNCR = 0;
+    }
+    else if (reg == &hostSPI.SPI_TDR)
+    {
+        stall (busyUntil);
+        busyUntil = hostCycles + WORD_CYCLES;
+        send (value);
+    }
+#endif
+}
+
+void hostBusStart (void)
+{
+#ifdef BUS_SPI
+    words = 0;
+#endif
+}
+
+void hostBusModel (unsigned long frames)
+{
+    double period = 1000.0 / FRAME_RATE;
+    double bus;
+
+    if (frames == 0)
+        return;
+#ifdef BUS_SPI
+    bus = (double)words * WORD_CYCLES;
+    printf ("bus       spi at %.1f MHz, %.1f words per frame, %.1f MHz to fit %.2f ms\n",
+            MCK / SPI_DIVIDER / 1e6, (double)words / frames,
+            (double)words / frames * 9 / period / 1e3, period);
+#else
+    bus = (double)busStats.stores * PIO_CYCLES;
+    printf ("bus       parallel, %d cycles per store\n", PIO_CYCLES);
+#endif
+
+    bus = bus / frames * 1000 / MCK;
+    printf ("bus ms    %.2f per frame of %.2f, %.1f frames/s at most%s\n",
+            bus, period, 1000 / bus, bus > period ? " (bus too slow)" : "");
+}
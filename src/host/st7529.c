@@ -0,0 +1,210 @@
+/*
+ * st7529.c
+ *
+ * Host emulation of the ST7529 on the PIOA bus, see st7529.h. Only the parts
+ * of the controller the firmware uses are modelled: the two command tables,
+ * the RAMWR window in 3 byte 3 pixel mode, area scrolling, display on/off
+ * and the gray PWM tables. Everything else is accepted and ignored.
+ *
+ * John Howe 2010
+ */
+
+#include <string.h>
+#include "lcd.h"
+#include "st7529.h"
+
+busStats_t busStats;
+uint8 gddram[LCD_HEIGHT][LCD_WIDTH];
+
+static FILE *trace;
+
+static struct {
+    uint8 ext;              // command table, 0 or 1
+    uint8 command;          // last command, for its parameters
+    uint8 index;            // parameters received
+    uint8 params[4];
+    uint8 on;
+    uint8 startCol, endCol; // RAMWR window
+    uint8 startLine, endLine;
+    uint8 col, line, pixel; // RAMWR position
+    uint8 scroll;           // SCSTART block
+    uint8 gray[2][GRAY_PARAMS];
+} lcd;
+
+static void reset (void)
+{
+    memset (&lcd, 0, sizeof(lcd));
+    lcd.endCol = LCD_WIDTH/3 - 1;
+    lcd.endLine = LCD_HEIGHT - 1;
+}
+
+static void command (uint8 c)
+{
+    busStats.commands++;
+    lcd.command = c;
+    lcd.index = 0;
+
+    if (c == EXTIN || c == EXTOUT)
+    {
+        lcd.ext = c & 1;
+        return;
+    }
+    if (lcd.ext)
+        return;
+    switch (c)
+    {
+        case DISON:  lcd.on = TRUE; break;
+        case DISOFF: lcd.on = FALSE; break;
+        case RAMWR:
+            lcd.col = lcd.startCol;
+            lcd.line = lcd.startLine;
+            lcd.pixel = 0;
+            break;
+    }
+}
+
+static void ramwr (uint8 d)
+{
+    busStats.pixels++;
+    if (lcd.line < LCD_HEIGHT && lcd.col < LCD_WIDTH/3)
+        gddram[lcd.line][lcd.col*3 + lcd.pixel] = d;
+    if (++lcd.pixel < 3)
+        return;
+    lcd.pixel = 0;
+    if (lcd.col++ < lcd.endCol)
+        return;
+    lcd.col = lcd.startCol;
+    if (lcd.line++ == lcd.endLine)
+        lcd.line = lcd.startLine;
+}
+
+static void data (uint8 d)
+{
+    uint8 i = lcd.index++;
+
+    if (lcd.ext)
+    {
+        if ((lcd.command == GRAY1 || lcd.command == GRAY2) && i < GRAY_PARAMS)
+            lcd.gray[lcd.command - GRAY1][i] = d;
+        return;
+    }
+    if (lcd.command == RAMWR)
+    {
+        ramwr (d);
+        return;
+    }
+    if (i < sizeof(lcd.params))
+        lcd.params[i] = d;
+    switch (lcd.command)
+    {
+        case CASET:
+            if (i == 0) lcd.startCol = d;
+            if (i == 1) lcd.endCol = d;
+            break;
+        case LASET:
+            if (i == 0) lcd.startLine = d;
+            if (i == 1) lcd.endLine = d;
+            break;
+        case SCSTART:
+            if (i == 0) lcd.scroll = d;
+            break;
+    }
+}
+
+/* Bus pins as the controller sees them */
+static uint8 busByte (uint32 pins)
+{
+    static const uint32 bits[8] = { PD0, PD1, PD2, PD3, PD4, PD5, PD6, PD7 };
+    uint8 d = 0;
+    for (int i = 0; i < 8; i++)
+        if (pins & bits[i])
+            d |= 1 << i;
+    return d;
+}
+
+/* A byte clocked in, with the state of A0 */
+static void latch (uint8 a0, uint8 d)
+{
+    busStats.bytes++;
+    if (trace && !(a0 && lcd.command == RAMWR && !lcd.ext))
+        fprintf (trace, "%c %02X\n", a0 ? 'D' : 'C', d);
+    if (a0)
+        data (d);
+    else
+        command (d);
+}
+
+void hostPioWrite (volatile unsigned int *reg, unsigned int value)
+{
+    AT91PS_PIO p = &hostPIOA;
+    uint32 before = p->PIO_ODSR;
+
+    if (reg == &p->PIO_SODR)
+        p->PIO_ODSR |= value;
+    else if (reg == &p->PIO_CODR)
+        p->PIO_ODSR &= ~value;
+    else if (reg == &p->PIO_ODSR)
+        p->PIO_ODSR = (p->PIO_ODSR & ~p->PIO_OWSR) | (value & p->PIO_OWSR);
+    else if (reg == &p->PIO_OWER)
+        p->PIO_OWSR |= value;
+    else if (reg == &p->PIO_OWDR)
+        p->PIO_OWSR &= ~value;
+    else
+    {
+        *reg = value;
+        return;
+    }
+    busStats.stores++;
+    hostCycles += PIO_CYCLES;
+
+    uint32 after = p->PIO_ODSR;
+    if (!(after & PRST))
+    {
+        reset ();
+        return;
+    }
+    if (!(after & PXCS) && !(before & PWR) && (after & PWR))
+        latch ((after & PA0) != 0, busByte (after));
+}
+
+void st7529Serial (uint16 word)
+{
+    latch ((word & 0x100) != 0, word); // A0 leads the byte
+}
+
+uint8 st7529DisplayOn (void)
+{
+    return lcd.on;
+}
+
+uint8 st7529ScrollStart (void)
+{
+    return lcd.scroll * SCROLL_BLOCK;
+}
+
+const uint8 *st7529Gray (uint8 frame)
+{
+    return lcd.gray[frame == 2];
+}
+
+uint8 st7529Ext (void)
+{
+    return lcd.ext;
+}
+
+void st7529Trace (FILE *f)
+{
+    trace = f;
+}
+
+int writePGM (FILE *f)
+{
+    fprintf (f, "P5\n%d %d\n31\n", LCD_WIDTH, LCD_HEIGHT);
+    for (int y = 0; y < LCD_HEIGHT; y++)
+    {
+        const uint8 *row = gddram[(y + st7529ScrollStart ()) % LCD_HEIGHT];
+        for (int x = 0; x < LCD_WIDTH; x++)
+            fputc (lcd.on ? 31 - (row[x] >> 3) : 31, f);
+    }
+    return !ferror (f);
+}
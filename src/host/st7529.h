@@ -0,0 +1,51 @@
+/*
+ * st7529.h
+ *
+ * Host emulation of the ST7529 on the PIOA bus. Every PIO_WRITE() in the
+ * shared code lands in hostPioWrite(), which updates hostPIOA the way the
+ * PIO controller would and clocks bytes into the emulated controller on
+ * each rising edge of WR while XCS is low. The SPI back-end's words reach
+ * st7529Serial() instead, from host/spi.c.
+ *
+ * John Howe 2010
+ */
+
+#ifndef ST7529_H
+#define ST7529_H
+
+#include <stdio.h>
+#include "config.h"
+#include "HG24016001G.h"
+
+typedef struct {
+    unsigned long stores;   // stores to PIO_SODR, PIO_CODR and PIO_ODSR
+    unsigned long bytes;    // bytes latched by the controller
+    unsigned long commands; // of which were commands
+    unsigned long pixels;   // of which were RAMWR data
+} busStats_t;
+
+extern busStats_t busStats;
+
+/* Display RAM as written, one byte (shade<<3) per pixel */
+extern uint8 gddram[LCD_HEIGHT][LCD_WIDTH];
+
+void hostPioWrite (volatile unsigned int *reg, unsigned int value);
+
+/* One 9 bit word on the serial interface, A0 in bit 8 */
+void st7529Serial (uint16 word);
+
+/* Controller state the driver can be checked against */
+uint8 st7529DisplayOn (void);
+uint8 st7529ScrollStart (void); // first line shown, after SCSTART
+const uint8 *st7529Gray (uint8 frame); // GRAY1 (1) or GRAY2 (2) parameters
+uint8 st7529Ext (void); // command table in use, 0 or 1
+
+/* Decode the bus into f: one line per byte latched, "C xx" for commands and
+ * "D xx" for parameters, leaving out RAMWR data. NULL stops. */
+void st7529Trace (FILE *f);
+
+/* Write the panel as it would be seen (scroll applied, blank when off, 0 is
+ * white) as a binary PGM. Returns FALSE on a write error. */
+int writePGM (FILE *f);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * timers.c
+ *
+ * Host version of ../timers.c. There is nothing to wait for on the host:
+ * frames are presented as soon as they are ready.
+ *
+ * cycleCount() is the model's clock, so the profiler (profile.h) sees
+ * the modelled bus time of each point, and the DBGU sends its telemetry
+ * with each frame.
+ *
+ * John Howe 2010
+ */
+
+#include "timers.h"
+#include "profile.h"
+
+volatile frameStats_t frameStats;
+volatile uint32 ticks;
+
+static void (*present)(void);
+
+unsigned long hostCycles;
+
+void initTimers(void) {
+}
+
+void busyWait(uint32 delay) {
+    (void)delay;
+}
+
+void startFrames(uint16 rate, void (*callback)(void)) {
+    (void)rate;
+    present = callback;
+    ticks = 0;
+    frameStats.frames = 0;
+    frameStats.overruns = 0;
+}
+
+void stopFrames(void) {
+}
+
+#ifdef PROFILE
+uint32 cycleCount(void) {
+    return hostCycles;
+}
+#endif
+
+void nextFrame(void) {
+    PROFILE_FRAME();
+    if (present)
+        present();
+    hostDbguTransmit();
+    ticks++;
+    frameStats.frames++;
+}
+
+void waitFrames(uint32 count) {
+    ticks += count;
+}
@@ -0,0 +1,96 @@
+/*
+ * uart.c
+ *
+ * Host simulation of USART0 and its PDC channel for ../usart.c. Characters
+ * are placed into the DMA buffers the way the PDC would: when RCR reaches 0
+ * the next pointer/counter take over and ENDRX is flagged until the driver
+ * queues another buffer.
+ *
+ * The DBGU's transmit PDC channel (../telemetry.c) is drained in one go
+ * whenever hostDbguTransmit() is called.
+ *
+ * The PDC pointer registers are only 32 bits wide, so on a 64 bit host the
+ * buffer a pointer register refers to is found by matching its low bits.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include "usart.h"
+#include "telemetry.h"
+
+AT91S_PMC hostPMC;
+AT91S_USART hostUS0;
+AT91S_PDC hostPDC_US0;
+AT91S_DBGU hostDBGU;
+AT91S_PDC hostPDC_DBGU;
+FILE *hostTelemetry;
+
+static uint8 *fill; // where the next character goes
+
+static uint8 *resolve (AT91_REG address)
+{
+    for (int i = 0; i < 2; i++)
+        if ((AT91_REG)(unsigned long)usartBuffer[i] == address)
+            return usartBuffer[i];
+    return NULL;
+}
+
+/* Bring the status bits up to date before the driver looks at them */
+static void update (void)
+{
+    if (hostPDC_US0.PDC_RNCR == 0)
+        hostUS0.US_CSR |= AT91C_US_ENDRX;
+    else
+        hostUS0.US_CSR &= ~AT91C_US_ENDRX;
+}
+
+int hostUsartReceive (unsigned char c)
+{
+    if (fill == NULL)
+        fill = resolve (hostPDC_US0.PDC_RPR);
+
+    hostUS0.US_CSR &= ~AT91C_US_TIMEOUT;
+    if (hostPDC_US0.PDC_RCR == 0)
+    {
+        hostUS0.US_CSR |= AT91C_US_OVRE;
+        update ();
+        return FALSE;
+    }
+
+    *fill++ = c;
+    if (--hostPDC_US0.PDC_RCR == 0 && hostPDC_US0.PDC_RNCR)
+    {
+        fill = resolve (hostPDC_US0.PDC_RNPR);
+        hostPDC_US0.PDC_RPR = hostPDC_US0.PDC_RNPR;
+        hostPDC_US0.PDC_RCR = hostPDC_US0.PDC_RNCR;
+        hostPDC_US0.PDC_RNCR = 0;
+    }
+    update ();
+    return TRUE;
+}
+
+void hostUsartIdle (void)
+{
+    hostUS0.US_CSR |= AT91C_US_TIMEOUT;
+    update ();
+}
+
+static void transmit (AT91_REG address, AT91_REG count)
+{
+    uint32 offset = (uint32)(address - (AT91_REG)(unsigned long)telemetryRing);
+    if (hostTelemetry && count)
+        fwrite (telemetryRing + offset, 1, count, hostTelemetry);
+}
+
+void hostDbguTransmit (void)
+{
+    // PTCR keeps what was written, and stands in for PTSR
+    if (!(hostPDC_DBGU.PDC_PTCR & AT91C_PDC_TXTEN))
+        return;
+    transmit (hostPDC_DBGU.PDC_TPR, hostPDC_DBGU.PDC_TCR);
+    transmit (hostPDC_DBGU.PDC_TNPR, hostPDC_DBGU.PDC_TNCR);
+    hostPDC_DBGU.PDC_TPR = hostPDC_DBGU.PDC_TNPR + hostPDC_DBGU.PDC_TNCR;
+    hostPDC_DBGU.PDC_TCR = 0;
+    hostPDC_DBGU.PDC_TNCR = 0;
+}
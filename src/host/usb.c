@@ -0,0 +1,42 @@
+/*
+ * usb.c
+ *
+ * Host version of ../usb.c. The OUT endpoint is replaced by a file or pipe
+ * (hostLink), read one bank of EP_OUT_SIZE bytes per pollUSB().
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include "usb.h"
+
+FILE *hostLink;
+
+static uint8 packet[EP_OUT_SIZE] __attribute__ ((aligned (4)));
+
+void initUSB (void)
+{
+    if (hostLink == NULL)
+        hostLink = stdin;
+}
+
+uint8 usbConfigured (void)
+{
+    return hostLink != NULL && !feof (hostLink);
+}
+
+void pollUSB (void)
+{
+    size_t count = fread (packet, 1, sizeof(packet), hostLink);
+    if (count)
+        parseLink (packet, count);
+}
+
+void usbLoop (void)
+{
+    initUSB ();
+    while (usbConfigured ())
+    {
+        pollUSB ();
+    }
+}
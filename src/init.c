@@ -21,7 +21,8 @@ void SpuriousInterruptHandler(void)
 }
 
 // Endless loop of LED_A (PA0) blinks for error diagnosis.
-// Will blink code-many times and then make a longer delay.
+// Will blink code-many times and then make a longer delay. Timed with
+// busyWait(), so TC1 must be running (initTimers()).
 void PanicBlinker(uint8 code)
 {
     // Be sure to enable the output so that we can also diagnose
@@ -34,15 +35,14 @@ void PanicBlinker(uint8 code)
     for(;;)
     {
         uint8 i;
-        unsigned int j;
         for(i=0; i<code; i++)
         {
             pPIO->PIO_CODR = LED_A;  // LOW = turn LED on.
-            for(j=PANIC_RATE; j; j--)  nop();
+            busyWait (PANIC_RATE);
             pPIO->PIO_SODR = LED_A;  // HIGH = turn LED off.
-            for(j=PANIC_RATE; j; j--)  nop();
+            busyWait (PANIC_RATE);
         }
-        for(j=PANIC_RATE*3; j; j--)  nop();
+        busyWait (3*PANIC_RATE);
     }
 }
 
@@ -52,10 +52,11 @@ void InitController(void)
 {
     // Set Flash Wait sate
     // Single Cycle Access at Up to 30 MHz, above (up to 55MHz):
-    //   at least 1 flash wait state.
-    // FMCN: flash microsecond cycle number: Number of MCLK cycles in one usec.
-    //   For 20 MHz, this is 20. Value must be rounded up.
-    AT91C_BASE_MC->MC_FMR = ((AT91C_MC_FMCN)&(22 <<16)) | AT91C_MC_FWS_0FWS;
+    //   at least 1 flash wait state. MCK is ~48 MHz (see Board.h) so one
+    //   wait state is required; time critical code runs from .ramfunc.
+    // FMCN: flash microsecond cycle number: Number of MCLK cycles in 1.5 usec
+    //   for flash programming. For 48 MHz, this is 72. Value must be rounded up.
+    AT91C_BASE_MC->MC_FMR = ((AT91C_MC_FMCN)&(72 <<16)) | AT91C_MC_FWS_1FWS;
 
     // Disable watchdog.
     AT91C_BASE_WDTC->WDTC_WDMR= AT91C_WDTC_WDDIS;
@@ -78,9 +79,11 @@ void InitController(void)
     // Field out NOT USED = 0
     // PLLCOUNT pll startup time estimate at : 0.844 ms
     // PLLCOUNT 28 = 0.000844 /(1/32768)
+    // USBDIV = 1: the UDP gets PLL/2 = 47.92 MHz (within the 0.25% USB allows)
     pPMC->PMC_PLLR = ((AT91C_CKGR_DIV & 0x05) |
             (AT91C_CKGR_PLLCOUNT & (28<<8)) |
-            (AT91C_CKGR_MUL & (25<<16)));
+            (AT91C_CKGR_MUL & (25<<16)) |
+            AT91C_CKGR_USBDIV_1);
     // Wait the startup time
     while(!(pPMC->PMC_SR & AT91C_PMC_LOCK));
     while(!(pPMC->PMC_SR & AT91C_PMC_MCKRDY));
@@ -133,6 +136,12 @@ void InitController(void)
 //    // Set outputs HIGH to turn LEDs off.
 //    pPIO->PIO_SODR = LED_A;
 
+#ifdef BUS_SPI
+    // Only reset is left on the PIO, initSPI() takes the serial pins
+    pPIO->PIO_PER = PRST;
+    pPIO->PIO_OER = PRST;
+    pPIO->PIO_CODR = PRST;
+#else
     // Enable PIO in output mode
     pPIO->PIO_PER = PA0 | PWR | PRD | PXCS | PRST | PD;
     pPIO->PIO_OER = PA0 | PWR | PRD | PXCS | PRST | PD;
@@ -140,6 +149,13 @@ void InitController(void)
     // Set all pins LOW
     pPIO->PIO_CODR = PA0 | PWR | PRD | PXCS | PRST | PD;
 
+#ifndef BUS_LEGACY
+    // Allow the LCD bus pins to be written together through PIO_ODSR
+    pPIO->PIO_OWER = BUS_MASK;
+#endif
+#endif
+
+    initTimers ();
     busyWait (50000); // Waiting for power to stabalise
 }
 
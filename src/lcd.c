@@ -7,19 +7,35 @@
  */
 
 #include "lcd.h"
+#include "aperture.h"
+#include "profile.h"
 
-uint32 table[256];
+uint32 pixelTable[256];
+
+static grayPWM_t graySlots[GRAY_SLOTS];
+static uint8 grayStored; // bit per slot holding a table
+static const grayPWM_t *graySelected; // sent again by initLCD()
+
+// Gray code sent for each logical level, see loadCalibration()
+static uint8 calibration[GRAY_LEVELS] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
+};
 
 
 void shiftFront (colour_t *colour);
+static void grayCommands (const grayPWM_t *pwm);
 
 /* Init function taken from datasheet */
 void initLCD(void) {
 
-    generateLookupTable ();
+    loadCalibration (calibration);
+#ifdef BUS_SPI
+    initSPI ();
+#endif
 
     volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
-    pPIO->PIO_SODR = PRST; // Reset pin High
+    PIO_WRITE (pPIO->PIO_SODR, PRST); // Reset pin High
 
     busyWait(10000); // 10ms
     write(COMMAND, EXTIN); // use the ext=0 command table
@@ -58,6 +74,9 @@ void initLCD(void) {
     write(DATA, 0x01); // Booter frequency = 6KHz
     write(DATA, 0x05); // bias = 1/11
     write(COMMAND, SWINT); // software initial
+    if (graySelected) {
+        grayCommands (graySelected); // SWINT restored the default gray PWM
+    }
 
     write(COMMAND, EXTIN); // use the ext=0 command table
     write(COMMAND, DISON); // turn display on
@@ -71,41 +90,53 @@ void initLCD(void) {
  * locations in a 32 bit integer corresponding to their PIO locations. This is
  * an expensive operation and needs to be executed every time an instruction is
  * sent to the LCD.
- * Instead, this pre-generates a 256 element array corresponding to each
- * possible instruction and its relevant mask on the PIO.
+ * Instead, a 256 element array holds each possible instruction's mask on the
+ * PIO. It is a constant expression of the pin map in config.h, so the
+ * compiler builds it and it costs nothing at boot.
  * 
  * This only increased speed by roughly 40%
+ *
+ * Each entry is now a complete PIO_ODSR word for the first half of a bus
+ * cycle (data bits placed, A0 low, WR low, RD high), so write() only has to OR
+ * in A0 for data and flip WR/RD for the latching half. See BUS_MASK.
  */
-uint32* generateLookupTable (void) {
-    //uint32* table = malloc(256 * sizeof(uint32));
-    //if (table == NULL) {
-        // Malloc failed
-        // TODO: flash error code - do not continue.
-    //}
-    //static uint32 table[256];
-
-    // do-while loop used here as for (i=0;i < 256;i++) would never exit
-    uint8 inst = 0;
-    do {
-        // calculate possible PIO combinations for any data input
-        uint32 instIO = 0;
-
-        // Rearrange bit order for pPIO
-        if (bitRead (inst, CD0)) { instIO |= PD0; }
-        if (bitRead (inst, CD1)) { instIO |= PD1; }
-        if (bitRead (inst, CD2)) { instIO |= PD2; }
-        if (bitRead (inst, CD3)) { instIO |= PD3; }
-        if (bitRead (inst, CD4)) { instIO |= PD4; }
-        if (bitRead (inst, CD5)) { instIO |= PD5; }
-        if (bitRead (inst, CD6)) { instIO |= PD6; }
-        if (bitRead (inst, CD7)) { instIO |= PD7; }
-
-        // store result
-        table[inst] = instIO;
-    }
-    while (inst++ != 255);
+#ifndef BUS_SHIFT
+#define BUS_BIT(b, n)   ((((b) >> CD##n) & 1) ? PD##n : 0)
+#define BUS_WORD(b)     (PRD | BUS_BIT (b, 0) | BUS_BIT (b, 1) | BUS_BIT (b, 2) | \
+                         BUS_BIT (b, 3) | BUS_BIT (b, 4) | BUS_BIT (b, 5) | \
+                         BUS_BIT (b, 6) | BUS_BIT (b, 7))
+#define BUS_4(b)        BUS_WORD (b), BUS_WORD (b+1), BUS_WORD (b+2), BUS_WORD (b+3)
+#define BUS_16(b)       BUS_4 (b), BUS_4 (b+4), BUS_4 (b+8), BUS_4 (b+12)
+#define BUS_64(b)       BUS_16 (b), BUS_16 (b+16), BUS_16 (b+32), BUS_16 (b+48)
 
-    return table;
+#ifndef BUS_TABLE_RAM
+const
+#endif
+uint32 table[256] = { BUS_64 (0), BUS_64 (64), BUS_64 (128), BUS_64 (192) };
+#else
+// busWord() is only a shift if D0-D7 really are in order
+typedef char busShiftCheck[(PD) == (0xFFUL << BUS_SHIFT) && PD0 == (1UL << BUS_SHIFT) &&
+        PD7 == (0x80UL << BUS_SHIFT) ? 1 : -1];
+#endif
+
+/* Composes the calibration curve with busWord() into pixelTable[]. The low
+ * three bits of a pixel byte are ignored by the panel in 32 gray mode and
+ * are passed through unchanged. The SPI back-end takes the 9 bit word
+ * instead, A0 and the calibrated byte. */
+void loadCalibration (const uint8 *curve) {
+    uint16 i;
+
+    for (i = 0; i < GRAY_LEVELS; i++)
+        calibration[i] = (curve ? curve[i] : i) & (GRAY_LEVELS-1);
+
+    for (i = 0; i < 256; i++)
+#ifdef BUS_SPI
+        pixelTable[i] = SPI_DATA | (calibration[i >> 3] << 3) | (i & 7);
+#elif defined(BUS_LEGACY)
+        pixelTable[i] = (calibration[i >> 3] << 3) | (i & 7);
+#else
+        pixelTable[i] = busWord ((calibration[i >> 3] << 3) | (i & 7)) | PA0;
+#endif
 }
 
 /* ---REMOVED AS MALLOC DOESN'T WORK--- */
@@ -122,66 +153,204 @@ uint32* generateLookupTable (void) {
 //}
 
 
-/* Writes instruction or data to I/O ports connected to LCD. */
+/* Writes instruction or data to I/O ports connected to LCD. The SPI
+ * versions of write(), beginBurst() and endBurst() are in lcdspi.c. */
+#ifndef BUS_SPI
+#ifdef BUS_LEGACY
 void write(uint8 type, uint8 instruction) {
 
     //busyWait(10000); 
+    PROFILE_BEGIN ();
     volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
     //uint32* table = tableButler();
 
     // Set Data/Command pin
     if (type == COMMAND) { // (control data)
-        pPIO->PIO_CODR = PA0; // A0 = 0
+        PIO_WRITE (pPIO->PIO_CODR, PA0); // A0 = 0
     } else { // type == DATA (display data)
-        pPIO->PIO_SODR = PA0; // A0 = 1
+        PIO_WRITE (pPIO->PIO_SODR, PA0); // A0 = 1
     }
 
     // Drop chip select to enable data/instruction I/O
-    pPIO->PIO_CODR = PXCS;
+    PIO_WRITE (pPIO->PIO_CODR, PXCS);
 
     // Drop WR and raise RD to prepare the lcd to read on D0-D7 pins
-    pPIO->PIO_CODR = PWR;
-    pPIO->PIO_SODR = PRD;
+    PIO_WRITE (pPIO->PIO_CODR, PWR);
+    PIO_WRITE (pPIO->PIO_SODR, PRD);
 
     // Write data bits to I/O
-    pPIO->PIO_CODR = PD;
-    pPIO->PIO_SODR = table[instruction];
+    PIO_WRITE (pPIO->PIO_CODR, PD);
+    PIO_WRITE (pPIO->PIO_SODR, busWord (instruction) & ~PRD);
 
     // Raise WR to have LCD latch data on D0-D7 pins
-    pPIO->PIO_SODR = PWR;
-    pPIO->PIO_CODR = PRD;
+    PIO_WRITE (pPIO->PIO_SODR, PWR);
+    PIO_WRITE (pPIO->PIO_CODR, PRD);
 
     // Raise chip select 
-    pPIO->PIO_SODR = PXCS;
+    PIO_WRITE (pPIO->PIO_SODR, PXCS);
+    PROFILE_END (PROFILE_WRITE);
 }
 
-/* Prepare the display to accept an image. Pixels start from 1 and startC and
- * endC must divide by 3. 
- * Returns number of (groups of 3) pixels */
-uint16 prepDisplay (uint8 startC, uint8 startR, uint8 endC, uint8 endR)
+/* Each byte of a burst is a write() of its own, as every pixel was before
+ * the PIO_ODSR bus, so there is nothing to set up or finish */
+void beginBurst (void)
+{
+}
+
+void endBurst (void)
+{
+}
+
+/* lcdstream.s drives PIO_ODSR, so the legacy bus has these instead */
+void streamPixels (const uint8 *pixels, uint16 count)
+{
+    while (count--)
+        burstWrite (*pixels++);
+}
+
+void burstFill (uint8 data, uint16 count)
+{
+    while (count--)
+        burstWrite (data);
+}
+#else
+/* Whole-byte version: the data, A0, WR and RD pins are enabled in PIO_OWSR
+ * (see InitController) so a single PIO_ODSR store sets all of them at once,
+ * leaving XCS, RST and the LED untouched. Four stores per byte instead of
+ * eight. */
+void write(uint8 type, uint8 instruction) {
+
+    PROFILE_BEGIN ();
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+
+    // Data, A0 and WR low, RD high
+    uint32 out = busWord (instruction);
+    if (type == DATA) {
+        out |= PA0; // A0 = 1
+    }
+
+    // Drop chip select to enable data/instruction I/O
+    PIO_WRITE (pPIO->PIO_CODR, PXCS);
+
+    // Present data with WR low, then raise WR (and drop RD) to latch it
+    PIO_WRITE (pPIO->PIO_ODSR, out);
+    PIO_WRITE (pPIO->PIO_ODSR, out ^ (PWR | PRD));
+
+    // Raise chip select 
+    PIO_WRITE (pPIO->PIO_SODR, PXCS);
+    PROFILE_END (PROFILE_WRITE);
+}
+
+void beginBurst (void)
 {
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    PIO_WRITE (pPIO->PIO_SODR, PA0); // A0 = 1, display data
+    PIO_WRITE (pPIO->PIO_CODR, PXCS);
+}
+
+void endBurst (void)
+{
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    PIO_WRITE (pPIO->PIO_SODR, PXCS);
+}
+#endif
+#endif
+
+/* Sets the RAMWR window in controller units and enters memory write mode.
+ * Columns are groups of three pixels (0-79), rows are lines (0-159), and both
+ * ends are inclusive. */
+void setWindow (uint8 startCol, uint8 startRow, uint8 endCol, uint8 endRow)
+{
+    PROFILE_BEGIN ();
     write (COMMAND, EXTIN); // ext = 0
     write (COMMAND, CASET); // column address set
-    write (DATA, (startC/3)-1); // from col 0xn
-    write (DATA, (endC/3)-1); // to col (0xn/3)-1
+    write (DATA, startCol); // from col
+    write (DATA, endCol); // to col
     write (COMMAND, LASET); // line address set
-    write (DATA, startR-1); // from line 0
-    write (DATA, endR-1); // to line 159
+    write (DATA, startRow); // from line
+    write (DATA, endRow); // to line
     write (COMMAND, RAMWR); // enter memory write mode
+    PROFILE_END (PROFILE_WINDOW);
+}
+
+/* Prepare the display to accept an image. Pixels start from 1 and are
+ * inclusive, so startC-1 and endC must divide by 3, e.g. (1, 1, 240, 160)
+ * for the whole panel.
+ * Returns number of (groups of 3) pixels */
+uint16 prepDisplay (uint8 startC, uint8 startR, uint8 endC, uint8 endR)
+{
+    uint8 startCol = (startC-1)/3;
+    uint8 endCol = (endC/3)-1;
+    setWindow (startCol, startR-1, endCol, endR-1);
 
-    uint16 pixels = ((endC-startC)/3)*(endR-startR);
-    return pixels;
+    return (endCol-startCol+1)*(endR-startR+1);
 }
 
+static void eraseRow (uint8 row, uint8 startCol, uint8 endCol)
+{
+    burstFill (WHITE, 3*(endCol-startCol));
+}
+
+/* Clears the aperture (aperture.h) to white */
 void eraseDisplay (void)
 {
-    uint16 pix = prepDisplay(0, 0, 240, 160);
-    while (pix--)
-    {
-        write (DATA, WHITE);
-        write (DATA, WHITE);
-        write (DATA, WHITE);
-    }
+    drawAperture (eraseRow);
+}
+
+/* GRAY1 and GRAY2 with their parameters. Assumes ext = 1. */
+static void grayCommands (const grayPWM_t *pwm)
+{
+    uint8 i;
+
+    write (COMMAND, GRAY1); // frame 1 gray PWM set
+    for (i = 0; i < GRAY_PARAMS; i++)
+        write (DATA, pwm->frame1[i] & 0x1F);
+    write (COMMAND, GRAY2); // frame 2 gray PWM set
+    for (i = 0; i < GRAY_PARAMS; i++)
+        write (DATA, pwm->frame2[i] & 0x1F);
+}
+
+void setGrayPWM (const grayPWM_t *pwm)
+{
+    write (COMMAND, EXTOUT); // ext = 1
+    grayCommands (pwm);
+    write (COMMAND, EXTIN); // ext = 0
+}
+
+void storeGrayPWM (uint8 slot, const grayPWM_t *pwm)
+{
+    if (slot >= GRAY_SLOTS)
+        return;
+    graySlots[slot] = *pwm;
+    grayStored |= 1 << slot;
+}
+
+uint8 selectGrayPWM (uint8 slot)
+{
+    if (slot >= GRAY_SLOTS || !(grayStored & (1 << slot)))
+        return FALSE;
+    graySelected = &graySlots[slot];
+    setGrayPWM (graySelected);
+    return TRUE;
+}
+
+/* Scroll the whole screen, see scrollTo() */
+void initScroll (void)
+{
+    write (COMMAND, EXTIN); // ext = 0
+    write (COMMAND, ASCSET); // area scroll set
+    write (DATA, 0x00); // top block
+    write (DATA, SCROLL_BLOCKS-1); // bottom block
+    write (DATA, SCROLL_BLOCKS-1); // number of specified blocks
+    write (DATA, 0x03); // whole screen scroll
+}
+
+/* Show display RAM block 'block' on the top line of the panel, wrapping
+ * around at the bottom. Assumes ext = 0, as left by setWindow(). */
+void scrollTo (uint8 block)
+{
+    write (COMMAND, SCSTART); // scroll start set
+    write (DATA, block);
 }
 
 void displayOff (void)
@@ -0,0 +1,54 @@
+/*
+ * lcdbench.c
+ *
+ * How fast streamPixels() runs from SRAM (.ramfunc) and from flash, with
+ * the wait state InitController() sets. Each row is timed on TC1 (MCK/2)
+ * and the fastest of the LCD_HEIGHT rows kept, so an interrupt in the
+ * middle of a row does not count.
+ *
+ * Nothing in the firmware calls it: run "streambench" in gdb
+ * (tools/gdb/gdbinit) once main() has set up the LCD, and read streamRate.
+ * "make bench" runs it on the simulator (host/bench.c).
+ *
+ * John Howe 2010
+ */
+
+#include "lcd.h"
+
+/* lcdstream.s has it for the parallel bus only */
+#if !defined(BUS_SPI) && !defined(BUS_LEGACY)
+
+void streamPixelsFlash (const uint8 *pixels, uint16 count);
+
+uint32 streamRate[2];
+
+static uint32 timeStream (void (*stream)(const uint8 *, uint16))
+{
+    static uint8 row[LCD_WIDTH] __attribute__ ((aligned (4)));
+    uint16 fastest = 0xFFFF;
+
+    for (int i = 0; i < LCD_WIDTH; i++)
+        row[i] = i;
+
+    setWindow (0, 0, LCD_WIDTH/3-1, LCD_HEIGHT-1);
+    beginBurst ();
+    for (int y = 0; y < LCD_HEIGHT; y++)
+    {
+        uint16 start = AT91C_BASE_TC1->TC_CV;
+        stream (row, LCD_WIDTH);
+        uint16 ticks = AT91C_BASE_TC1->TC_CV - start;
+        if (ticks < fastest)
+            fastest = ticks;
+    }
+    endBurst ();
+
+    return (unsigned long long)LCD_WIDTH * CYCLE_CLOCK / fastest;
+}
+
+void measureStream (void)
+{
+    streamRate[STREAM_RAM] = timeStream (streamPixels);
+    streamRate[STREAM_FLASH] = timeStream (streamPixelsFlash);
+}
+
+#endif
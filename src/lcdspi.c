@@ -0,0 +1,128 @@
+/*
+ * lcdspi.c
+ *
+ * LCD bus over the SPI (make BUS=spi), see lcd.h. The ST7529 takes 9 bit
+ * words on its serial interface, A0 then D7-D0, so each byte is one SPI
+ * transfer with BITS_9 and no pin needs driving by hand. Pixel words are
+ * gathered in spiBuffer[] and sent by the PDC: while one buffer is on the
+ * wire the CPU fills the other, and only waits if it gets a whole buffer
+ * ahead. Commands and their parameters are rare and go through SPI_TDR
+ * once the PDC has finished.
+ *
+ * This bus misses the frame budget. A whole panel is 38408 words, 9 bits
+ * each at MCK/SPI_DIVIDER, 16MHz: 21.64ms on the wire against the 20ms of
+ * a frame at FRAME_RATE 50. "make bench BUS=spi" measures 21.72ms for
+ * eraseDisplay(), slide() and drawWaves(), of which the CPU is busy for
+ * 12.0-12.7ms and waits on the PDC for the rest, so it has 7.3-8.0ms of
+ * the period free but the panel cannot be refreshed every tick. Any of
+ * these would bring it in:
+ * - an SPCK of 17.3MHz or more, SPI_DIVIDER 2 (24MHz, 14.4ms a frame) if
+ *   the panel's tSCYC allows it at the supply used
+ * - sending only the aperture (aperture.h) rather than the whole panel
+ * - a FRAME_RATE of 40, a 25ms period
+ * The loops that only scroll or redraw part of the panel (wavesLoop,
+ * turbulenceLoop) keep up as it is.
+ *
+ * John Howe 2010
+ */
+
+#include "lcd.h"
+#include "profile.h"
+
+#ifdef BUS_SPI
+
+uint16 spiBuffer[2][SPI_CHUNK];
+uint16 *spiNext = spiBuffer[0], *spiEnd = spiBuffer[0] + SPI_CHUNK;
+static uint8 spiFilling; // buffer spiNext points into
+
+void initSPI (void)
+{
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    volatile AT91PS_SPI pSPI = AT91C_BASE_SPI;
+
+    AT91C_BASE_PMC->PMC_PCER = 1 << AT91C_ID_SPI;
+
+    // SPCK, MOSI and NPCS0 to peripheral A
+    pPIO->PIO_ASR = AT91C_PA14_SPCK | AT91C_PA13_MOSI | AT91C_PA11_NPCS0;
+    pPIO->PIO_PDR = AT91C_PA14_SPCK | AT91C_PA13_MOSI | AT91C_PA11_NPCS0;
+
+    SPI_WRITE (pSPI->SPI_CR, AT91C_SPI_SWRST);
+    SPI_WRITE (pSPI->SPI_MR, AT91C_SPI_MSTR | AT91C_SPI_MODFDIS | (0xE << 16)); // NPCS0
+    // SCL idles high and the panel samples SDA on its rising edge
+    SPI_WRITE (pSPI->SPI_CSR[0], AT91C_SPI_CPOL | AT91C_SPI_BITS_9 | (SPI_DIVIDER << 8));
+    SPI_WRITE (pSPI->SPI_CR, AT91C_SPI_SPIEN);
+    SPI_WRITE (pSPI->SPI_PTCR, AT91C_PDC_TXTEN);
+}
+
+void spiFlush (void)
+{
+    volatile AT91PS_SPI pSPI = AT91C_BASE_SPI;
+    uint16 *start = spiBuffer[spiFilling];
+
+    if (spiNext == start)
+        return;
+
+    // Queued behind the buffer being sent, if any; the PDC moves on to it
+    // by itself
+    SPI_WRITE (pSPI->SPI_TNPR, (uint32)start);
+    SPI_WRITE (pSPI->SPI_TNCR, spiNext - start);
+
+    spiFilling ^= 1;
+    spiNext = spiBuffer[spiFilling];
+    spiEnd = spiNext + SPI_CHUNK;
+
+    // The other buffer is free once the PDC has taken the one just queued
+    while (pSPI->SPI_TNCR)
+        ;
+}
+
+/* Writes instruction or data to the LCD, after any pixels still queued */
+void write (uint8 type, uint8 instruction)
+{
+    PROFILE_BEGIN ();
+    volatile AT91PS_SPI pSPI = AT91C_BASE_SPI;
+
+    spiFlush ();
+    while (!(pSPI->SPI_SR & AT91C_SPI_TXBUFE))
+        ;
+    while (!(pSPI->SPI_SR & AT91C_SPI_TDRE))
+        ;
+    SPI_WRITE (pSPI->SPI_TDR, (type == DATA ? SPI_DATA : 0) | instruction);
+    PROFILE_END (PROFILE_WRITE);
+}
+
+/* NPCS0 follows the transfers, so a burst is only a matter of sending the
+ * last buffer at the end */
+void beginBurst (void)
+{
+}
+
+void endBurst (void)
+{
+    spiFlush ();
+}
+
+void streamPixels (const uint8 *pixels, uint16 count)
+{
+    while (count--)
+        burstWrite (*pixels++);
+}
+
+void burstFill (uint8 data, uint16 count)
+{
+    uint16 word = pixelTable[data];
+
+    while (count)
+    {
+        uint16 n = spiEnd - spiNext;
+        if (n > count)
+            n = count;
+        count -= n;
+        while (n--)
+            *spiNext++ = word;
+        if (spiNext == spiEnd)
+            spiFlush ();
+    }
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * lcdstream.s
+ *
+ * Pixel streaming and fill kernels for the LCD bus. Runs from SRAM (.ramfunc, copied
+ * there by crt.s) in ARM mode so the inner loop does not stall on flash wait
+ * states.
+ *
+ * John Howe 2010
+ */
+
+/* The SPI back-end has its own, in lcdspi.c, and the legacy bus its own in
+ * lcd.c */
+#if !defined(BUS_SPI) && !defined(BUS_LEGACY)
+
+/* Must match config.h */
+.set  PIOA_BASE,    0xFFFFF400      /* AT91C_BASE_PIOA                  */
+.set  PIO_ODSR,     0x38            /* Output Data Status Register      */
+.set  BUS_STROBE,   0x10000010      /* PWR | PRD (PA4 | PA28)           */
+
+.global streamPixels
+.global streamPixelsFlash
+.global burstFill
+
+/* ======================================================================== */
+/* void streamPixels (const uint8 *pixels, uint16 count)                    */
+/*                                                                          */
+/* Clocks count pixel bytes out to the LCD inside a beginBurst()/endBurst() */
+/* pair. Each byte is encoded through pixelTable[], which already has A0    */
+/* set and the calibration curve applied, and written as two PIO_ODSR       */
+/* stores (WR low, then WR high). An STM cannot be used for the stores as   */
+/* it increments the address, so the main loop instead loads four pixels   */
+/* per LDR and interleaves the table lookups of the next byte with the      */
+/* stores of the current one to hide the load-use interlock.                */
+/*                                                                          */
+/*   r0 pixels      r1 count       r2 PIO base    r3 pixelTable             */
+/*   r4-r7 pixels being encoded    r12 WR/RD strobe mask                    */
+/*                                                                          */
+/* A macro, assembled once into .ramfunc as streamPixels and once into      */
+/* flash as streamPixelsFlash.                                              */
+/* ======================================================================== */
+.macro STREAM_PIXELS
+                stmfd   sp!, {r4-r7}
+                ldr     r2, =PIOA_BASE
+                ldr     r3, =pixelTable
+                ldr     r12, =BUS_STROBE
+
+                /* Byte at a time until the source is word aligned */
+1:              tst     r0, #3
+                beq     2f
+                subs    r1, r1, #1
+                bmi     5f
+                ldrb    r4, [r0], #1
+                ldr     r4, [r3, r4, lsl #2]
+                str     r4, [r2, #PIO_ODSR]
+                eor     r4, r4, r12
+                str     r4, [r2, #PIO_ODSR]
+                b       1b
+
+                /* Four pixels per iteration */
+2:              subs    r1, r1, #4
+                bmi     4f
+3:              ldr     r4, [r0], #4
+                and     r5, r4, #0xFF
+                mov     r6, r4, lsr #8
+                ldr     r5, [r3, r5, lsl #2]
+                and     r6, r6, #0xFF
+                ldr     r6, [r3, r6, lsl #2]
+                str     r5, [r2, #PIO_ODSR]
+                eor     r5, r5, r12
+                str     r5, [r2, #PIO_ODSR]
+                mov     r7, r4, lsr #16
+                and     r7, r7, #0xFF
+                ldr     r7, [r3, r7, lsl #2]
+                str     r6, [r2, #PIO_ODSR]
+                eor     r6, r6, r12
+                str     r6, [r2, #PIO_ODSR]
+                mov     r4, r4, lsr #24
+                ldr     r4, [r3, r4, lsl #2]
+                str     r7, [r2, #PIO_ODSR]
+                eor     r7, r7, r12
+                str     r7, [r2, #PIO_ODSR]
+                str     r4, [r2, #PIO_ODSR]
+                eor     r4, r4, r12
+                str     r4, [r2, #PIO_ODSR]
+                subs    r1, r1, #4
+                bpl     3b
+
+                /* Up to three trailing pixels */
+4:              adds    r1, r1, #4
+                beq     5f
+6:              ldrb    r4, [r0], #1
+                ldr     r4, [r3, r4, lsl #2]
+                str     r4, [r2, #PIO_ODSR]
+                eor     r4, r4, r12
+                str     r4, [r2, #PIO_ODSR]
+                subs    r1, r1, #1
+                bne     6b
+
+5:              ldmfd   sp!, {r4-r7}
+                bx      lr
+.endm
+
+.section .ramfunc, "ax", %progbits
+.arm
+.align 2
+
+streamPixels:
+                STREAM_PIXELS
+
+/* ======================================================================== */
+/* void burstFill (uint8 data, uint16 count)                                */
+/*                                                                          */
+/* Clocks the same byte out count times inside a beginBurst()/endBurst()    */
+/* pair. The byte is looked up in pixelTable[] once, so each byte is only   */
+/* two strobe stores, unrolled eight bytes per iteration.                   */
+/*                                                                          */
+/*   r0 WR low word    r1 count    r2 PIO base    r3 WR high word           */
+/* ======================================================================== */
+burstFill:
+                ldr     r2, =pixelTable
+                ldr     r0, [r2, r0, lsl #2]
+                ldr     r3, =BUS_STROBE
+                ldr     r2, =PIOA_BASE
+                eor     r3, r0, r3
+
+                /* Eight bytes per iteration */
+                subs    r1, r1, #8
+                bmi     2f
+1:              str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                subs    r1, r1, #8
+                bpl     1b
+
+                /* Up to seven trailing bytes */
+2:              adds    r1, r1, #8
+                bxeq    lr
+3:              str     r0, [r2, #PIO_ODSR]
+                str     r3, [r2, #PIO_ODSR]
+                subs    r1, r1, #1
+                bne     3b
+                bx      lr
+
+.ltorg
+
+/* The same kernel left in flash, for measureStream() (lcdbench.c) to time
+ * against streamPixels */
+.text
+.arm
+.align 2
+streamPixelsFlash:
+                STREAM_PIXELS
+
+.ltorg
+
+#endif
+
+.end
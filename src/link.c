@@ -0,0 +1,184 @@
+/*
+ * link.c
+ *
+ * Frame protocol between the PC and the SLM. Receivers (USB, ...) pass
+ * whatever bytes they get to parseLink(), which finds the frame headers and
+ * streams each payload to the LCD without buffering the frame.
+ *
+ * John Howe 2010
+ */
+
+#include <string.h>
+#include "link.h"
+#include "lcd.h"
+#include "codec.h"
+#include "seqstore.h"
+#include "displist.h"
+
+enum { SYNC0, SYNC1, FORMAT, SEQUENCE, LENGTH_LO, LENGTH_HI, PAYLOAD, SKIP };
+
+linkStats_t linkStats;
+
+static uint8 state = SYNC0;
+static uint8 format;
+static uint8 sequence;
+static uint8 expected; // next sequence number
+static uint8 started = FALSE; // a header has been seen
+static uint16 remaining; // payload bytes still to come
+// FORMAT_CALIBRATION and FORMAT_GRAY payloads are collected here
+static uint8 setting[1 + 2*GRAY_PARAMS];
+static uint8 settingBytes;
+
+/* Called once the header has been read. Returns the state for the payload */
+static uint8 startPayload (void)
+{
+    if (started)
+        linkStats.dropped += (uint8)(sequence - expected);
+    expected = sequence + 1;
+    started = TRUE;
+
+    if ((format == FORMAT_RAW && remaining == FRAME_BYTES) ||
+        ((format == FORMAT_RLE || format == FORMAT_DELTA) && remaining))
+    {
+        setWindow (0, 0, LCD_WIDTH/3-1, LCD_HEIGHT-1);
+        beginBurst ();
+        startDecode (format);
+        return PAYLOAD;
+    }
+    if (format == FORMAT_LIST && remaining)
+    {
+        startList ();
+        return PAYLOAD;
+    }
+    if (format == FORMAT_PAGE && remaining == 2 + STORE_PAGE)
+    {
+        startPage ();
+        return PAYLOAD;
+    }
+    if ((format == FORMAT_CALIBRATION && remaining == GRAY_LEVELS) ||
+        (format == FORMAT_GRAY && (remaining == 1 || remaining == 1 + 2*GRAY_PARAMS)))
+    {
+        settingBytes = 0;
+        return PAYLOAD;
+    }
+
+    linkStats.errors++;
+    return remaining ? SKIP : SYNC0;
+}
+
+static void endPayload (void)
+{
+    if (format == FORMAT_PAGE)
+    {
+        if (endPage ())
+            linkStats.pages++;
+        else
+            linkStats.errors++;
+        return;
+    }
+    if (format == FORMAT_CALIBRATION)
+    {
+        loadCalibration (setting);
+        return;
+    }
+    if (format == FORMAT_GRAY)
+    {
+        if (settingBytes > 1)
+            storeGrayPWM (setting[0], (const grayPWM_t *)(setting + 1));
+        if (!selectGrayPWM (setting[0]))
+            linkStats.errors++;
+        return;
+    }
+    if (format == FORMAT_LIST)
+    {
+        if (endList ())
+            linkStats.frames++;
+        else
+            linkStats.errors++;
+        return;
+    }
+    endBurst ();
+    if (decodeComplete ())
+        linkStats.frames++;
+    else
+        linkStats.errors++;
+}
+
+void parseLink (const uint8 *data, uint16 count)
+{
+    while (count)
+    {
+        switch (state)
+        {
+            case PAYLOAD:
+            case SKIP:
+            {
+                uint16 n = count < remaining ? count : remaining;
+                if (state == PAYLOAD && format == FORMAT_RAW)
+                {
+                    streamPixels (data, n);
+                    storePixels (data, n);
+                }
+                else if (state == PAYLOAD && format == FORMAT_LIST)
+                    listData (data, n);
+                else if (state == PAYLOAD && format == FORMAT_PAGE)
+                    pageData (data, n);
+                else if (state == PAYLOAD && format >= FORMATS)
+                {
+                    memcpy (setting + settingBytes, data, n);
+                    settingBytes += n;
+                }
+                else if (state == PAYLOAD)
+                    decode (data, n);
+                data += n;
+                count -= n;
+                remaining -= n;
+                if (remaining == 0)
+                {
+                    if (state == PAYLOAD)
+                        endPayload ();
+                    state = SYNC0;
+                }
+                continue;
+            }
+            case SYNC0:
+                if (*data == LINK_SYNC0)
+                    state = SYNC1;
+                break;
+            case SYNC1:
+                if (*data == LINK_SYNC1)
+                    state = FORMAT;
+                else if (*data != LINK_SYNC0)
+                    state = SYNC0;
+                break;
+            case FORMAT:
+                format = *data;
+                state = SEQUENCE;
+                break;
+            case SEQUENCE:
+                sequence = *data;
+                state = LENGTH_LO;
+                break;
+            case LENGTH_LO:
+                remaining = *data;
+                state = LENGTH_HI;
+                break;
+            case LENGTH_HI:
+                remaining |= *data << 8;
+                state = startPayload ();
+                break;
+        }
+        data++;
+        count--;
+    }
+}
+
+void resetLink (void)
+{
+    if (state == PAYLOAD && format == FORMAT_LIST)
+        endList ();
+    else if (state == PAYLOAD && format < FORMATS)
+        endBurst ();
+    state = SYNC0;
+    started = FALSE;
+}
@@ -10,6 +10,10 @@
 #include "init.h"
 #include "lcd.h"
 #include "animate.h"
+#include "usb.h"
+#include "usart.h"
+#include "seqstore.h"
+#include "telemetry.h"
 
 
 
@@ -19,10 +23,18 @@ int main(void)
 {
     InitController();
     initLCD ();
+#if defined(PROFILE) && defined(BUS_SPI)
+    initTelemetry (); // the profile goes out on the DBGU
+#endif
 
     slideLoop();
     //wavesLoop();
     //seesawLoop();
+    //turbulenceLoop();
+    //zernikeLoop();
+    //storeLoop();
+    //usbLoop();
+    //usartLoop();
 
     return(0);
 }
@@ -0,0 +1,115 @@
+/*
+ * profile.c
+ *
+ * The cycle profiler, see profile.h
+ *
+ * John Howe 2010
+ */
+
+#include "profile.h"
+#include "telemetry.h"
+
+#ifdef PROFILE
+
+profile_t profiles[PROFILE_POINTS];
+const char *const profileNames[PROFILE_POINTS] = { "write", "window", "slide", "frame" };
+
+static uint32 frameStart;
+static uint16 frames;
+
+/* The highest bit set, without CLZ (ARMv5) */
+static uint8 binOf (uint32 cycles)
+{
+    uint8 bin = 0;
+
+    if (cycles >> 16) { cycles >>= 16; bin += 16; }
+    if (cycles >> 8) { cycles >>= 8; bin += 8; }
+    if (cycles >> 4) { cycles >>= 4; bin += 4; }
+    if (cycles >> 2) { cycles >>= 2; bin += 2; }
+    if (cycles >> 1) bin += 1;
+    return bin < PROFILE_BINS ? bin : PROFILE_BINS-1;
+}
+
+void profileAdd (uint8 point, uint32 cycles)
+{
+    profile_t *p = &profiles[point];
+    uint16 *bin = &p->bins[binOf (cycles)];
+    uint32 cpsr = maskIRQ ();
+
+    if (p->count == 0 || cycles < p->min)
+        p->min = cycles;
+    if (cycles > p->max)
+        p->max = cycles;
+    p->total += cycles;
+    p->count++;
+    if (*bin != 0xFFFF)
+        (*bin)++;
+    restoreIRQ (cpsr);
+}
+
+void profileFrame (void)
+{
+    uint32 now = cycleCount ();
+
+    if (frames)
+        profileAdd (PROFILE_FRAME, now - frameStart);
+    frameStart = now;
+
+#ifdef BUS_SPI
+    if (++frames > PROFILE_REPORT)
+    {
+        profileReport ();
+        frames = 1; // this frame starts the next period
+    }
+    else
+        pollTelemetry ();
+#else
+    frames = 1; // no reports, profiles[] is left to gdb
+#endif
+}
+
+#ifdef BUS_SPI
+void profileReport (void)
+{
+    for (uint8 point = 0; point < PROFILE_POINTS; point++)
+    {
+        profile_t *p = &profiles[point];
+        uint8 used = PROFILE_BINS;
+
+        while (used && p->bins[used-1] == 0)
+            used--;
+
+        telemetryText (profileNames[point]);
+        telemetryText (" n ");
+        telemetryNumber (p->count);
+        if (p->count)
+        {
+            telemetryText (" min ");
+            telemetryNumber (p->min);
+            telemetryText (" mean ");
+            telemetryNumber (p->total / p->count);
+            telemetryText (" max ");
+            telemetryNumber (p->max);
+            telemetryText (" bins");
+            for (uint8 i = 0; i < used; i++)
+            {
+                telemetryText (" ");
+                telemetryNumber (p->bins[i]);
+            }
+        }
+        telemetryText ("\r\n");
+    }
+    profileClear ();
+}
+#endif
+
+void profileClear (void)
+{
+    uint32 cpsr = maskIRQ ();
+
+    for (uint8 point = 0; point < PROFILE_POINTS; point++)
+        profiles[point] = (profile_t){ 0 };
+    restoreIRQ (cpsr);
+}
+
+#endif
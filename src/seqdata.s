@@ -0,0 +1,19 @@
+/*
+ * seqdata.s
+ *
+ * The sequence store image made by tools/slmlink/slmpack, linked into the
+ * .seqstore section (ld_flash.cmd) so it is flashed with the firmware:
+ *
+ *   make SEQSTORE=../bins/store.bin
+ *
+ * Without SEQSTORE the section is empty and the store is left to be
+ * programmed over the link.
+ *
+ * John Howe 2010
+ */
+
+        .section .seqstore, "a"
+        .align  2
+#ifdef SEQSTORE_IMAGE
+        .incbin SEQSTORE_IMAGE
+#endif
@@ -0,0 +1,117 @@
+/*
+ * seqstore.c
+ *
+ * Playback of the frame sequences in the flash store (seqstore.h), and
+ * the link side of programming it. Stored frames are link protocol frames,
+ * so they go through the same decoders as frames from the PC and no frame
+ * is ever buffered in RAM.
+ *
+ * John Howe 2010
+ */
+
+#include <stddef.h>
+#include "seqstore.h"
+#include "timers.h"
+
+// FORMAT_PAGE payload being received
+static uint32 page[STORE_PAGE/4];
+static uint16 pageNumber;
+static uint16 received;
+
+static uint32 word (const uint8 *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32)p[3] << 24;
+}
+
+uint8 storeSequences (void)
+{
+    uint32 count = word (STORE_BASE + 4);
+
+    if (word (STORE_BASE) != STORE_MAGIC || count > STORE_SEQUENCES)
+        return 0;
+    return count;
+}
+
+uint8 playSequence (uint8 index, uint16 loops)
+{
+    if (index >= storeSequences ())
+        return FALSE;
+
+    const uint8 *entry = STORE_BASE + 8 + index*STORE_ENTRY;
+    uint32 offset = word (entry);
+    uint32 length = word (entry + 4);
+    uint8 rate = entry[10];
+    uint8 hold = entry[11];
+    if (offset < STORE_HEADER || length > STORE_SIZE || offset > STORE_SIZE - length ||
+            rate < STORE_MIN_RATE || hold == 0)
+        return FALSE;
+
+    startFrames (rate, NULL);
+    for (uint16 pass = 0; loops == 0 || pass < loops; pass++)
+    {
+        const uint8 *next = STORE_BASE + offset;
+        const uint8 *end = next + length;
+
+        resetLink ();
+        while (next < end)
+        {
+            uint32 size = LINK_HEADER + (next[4] | next[5] << 8);
+            if (next[0] != LINK_SYNC0 || next[1] != LINK_SYNC1 || size > (uint32)(end - next))
+            {
+                stopFrames ();
+                return FALSE;
+            }
+            uint8 format = next[2];
+            parseLink (next, size);
+            next += size;
+            if (format >= FORMATS)
+                continue; // not a frame (a calibration curve), nothing to show
+
+            nextFrame ();
+            if (hold > 1)
+                waitFrames (hold - 1);
+        }
+    }
+    stopFrames ();
+    return TRUE;
+}
+
+void storeLoop (void)
+{
+    uint8 count = storeSequences ();
+
+    if (count == 1)
+        playSequence (0, 0);
+    while (count)
+    {
+        for (uint8 i = 0; i < count; i++)
+            playSequence (i, 1);
+    }
+}
+
+void startPage (void)
+{
+    received = 0;
+}
+
+void pageData (const uint8 *data, uint16 count)
+{
+    while (count--)
+    {
+        if (received == 0)
+            pageNumber = *data;
+        else if (received == 1)
+            pageNumber |= *data << 8;
+        else if (received < 2 + STORE_PAGE)
+            ((uint8 *)page)[received - 2] = *data;
+        data++;
+        received++;
+    }
+}
+
+uint8 endPage (void)
+{
+    if (received != 2 + STORE_PAGE || pageNumber >= STORE_PAGES)
+        return FALSE;
+    return writeStorePage (pageNumber, page);
+}
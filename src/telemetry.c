@@ -0,0 +1,121 @@
+/*
+ * telemetry.c
+ *
+ * DBGU telemetry, see telemetry.h. The ring is sent as up to two
+ * contiguous pieces at a time: the one the PDC is on (TPR/TCR) and one
+ * queued behind it (TNPR/TNCR), each running to the head or to the end of
+ * the ring, whichever comes first.
+ *
+ * John Howe 2010
+ */
+
+#include <string.h>
+#include "Board.h"
+#include "slimLib.h"
+#include "telemetry.h"
+
+telemetryStats_t telemetryStats;
+char telemetryRing[TELEMETRY_SIZE];
+
+static uint16 head;     // where the next byte goes
+static uint16 tail;     // oldest byte the PDC may still be sending
+static uint16 queued;   // bytes from tail handed to the PDC
+static uint8 running;
+
+uint8 initTelemetry (void)
+{
+    AT91PS_DBGU pDBGU = AT91C_BASE_DBGU;
+    AT91PS_PDC pPDC = AT91C_BASE_PDC_DBGU;
+
+#ifndef BUS_SPI
+    if ((PD) & DBGU_TXD)
+        return FALSE; // DTXD is driving the LCD
+#endif
+
+    // Hand DTXD to the DBGU (peripheral A); the DBGU is clocked with the
+    // system controller, so there is no PMC clock to enable
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    pPIO->PIO_ASR = DBGU_TXD;
+    pPIO->PIO_PDR = DBGU_TXD;
+
+    pDBGU->DBGU_CR = AT91C_US_RSTTX;
+    pDBGU->DBGU_MR = AT91C_US_PAR_NONE | AT91C_US_CHMODE_NORMAL;
+    // MCK / (16 * 115200) = 26 exactly
+    pDBGU->DBGU_BRGR = (MCK + 8*AT91C_DBGU_BAUD) / (16*AT91C_DBGU_BAUD);
+
+    head = tail = queued = 0;
+    pPDC->PDC_PTCR = AT91C_PDC_TXTEN;
+    pDBGU->DBGU_CR = AT91C_US_TXEN;
+    running = TRUE;
+    return TRUE;
+}
+
+void pollTelemetry (void)
+{
+    AT91PS_PDC pPDC = AT91C_BASE_PDC_DBGU;
+    uint16 current, next;
+
+    if (!running)
+        return;
+
+    // The PDC may move on to the next piece between the two reads
+    do
+    {
+        current = pPDC->PDC_TCR;
+        next = pPDC->PDC_TNCR;
+    } while (current != pPDC->PDC_TCR);
+
+    uint16 done = queued - current - next;
+    tail = (tail + done) & (TELEMETRY_SIZE-1);
+    queued -= done;
+    telemetryStats.sent += done;
+
+    if (next == 0)
+    {
+        uint16 start = (tail + queued) & (TELEMETRY_SIZE-1);
+        uint16 count = (head - start) & (TELEMETRY_SIZE-1);
+        if (count > TELEMETRY_SIZE - start)
+            count = TELEMETRY_SIZE - start;
+        if (count)
+        {
+            pPDC->PDC_TNPR = (uint32)&telemetryRing[start];
+            pPDC->PDC_TNCR = count;
+            queued += count;
+        }
+    }
+}
+
+uint16 telemetry (const char *data, uint16 length)
+{
+    pollTelemetry ();
+
+    uint16 space = running ? (tail - head - 1) & (TELEMETRY_SIZE-1) : 0;
+    uint16 n = length < space ? length : space;
+    telemetryStats.dropped += length - n;
+
+    for (uint16 i = 0; i < n; i++)
+    {
+        telemetryRing[head] = data[i];
+        head = (head + 1) & (TELEMETRY_SIZE-1);
+    }
+    pollTelemetry ();
+    return n;
+}
+
+void telemetryText (const char *text)
+{
+    telemetry (text, strlen (text));
+}
+
+void telemetryNumber (uint32 value)
+{
+    char digits[10];
+    uint8 n = sizeof(digits);
+
+    do
+    {
+        digits[--n] = '0' + value % 10;
+        value /= 10;
+    } while (value && n);
+    telemetry (digits + n, sizeof(digits) - n);
+}
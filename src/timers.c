@@ -2,26 +2,179 @@
  * timers.c
  *
  * Timer functions to be used on the ARM7
+ *
+ * TC0 is the frame tick: it interrupts once per frame period and presents
+ * the frame the main loop has prepared, so the presentation time does not
+ * depend on how long the frame took to draw; it counts MCK/32, and the CPU
+ * sleeps rather than spins while it waits. TC1 runs freely at MCK/2 for
+ * busyWait() and, with PROFILE, the overflows counted in software, as the
+ * cycle clock for the profiler (profile.h).
  */
 
 #include "timers.h"
+#include "profile.h"
+
+volatile frameStats_t frameStats;
+volatile uint32 ticks;
+
+static void (*present)(void);
+static volatile uint8 ready; // a frame is waiting for the tick
+static uint32 presented; // tick of the last frame presented
+#ifdef PROFILE
+static volatile uint32 cycleHigh; // TC1 overflows
+#endif
+
+/* Enable/disable IRQs in the CPSR; crt.s leaves them disabled */
+static inline void enableIRQ(void) {
+    uint32 cpsr;
+    __asm__ __volatile__(
+            "mrs %0, cpsr\n\t"
+            "bic %0, %0, #0x80\n\t"
+            "msr cpsr_c, %0" : "=r" (cpsr) : : "memory");
+}
+
+static inline void disableIRQ(void) {
+    uint32 cpsr;
+    __asm__ __volatile__(
+            "mrs %0, cpsr\n\t"
+            "orr %0, %0, #0x80\n\t"
+            "msr cpsr_c, %0" : "=r" (cpsr) : : "memory");
+}
+
+/* Stop the processor clock until the next interrupt. Called with IRQs
+ * masked so a tick between testing and sleeping cannot be lost: the clock
+ * restarts on any interrupt the AIC asserts, and the handler runs as soon
+ * as IRQs are enabled again. */
+static inline void sleep(void) {
+    AT91C_BASE_PMC->PMC_SCDR = AT91C_PMC_PCK;
+    enableIRQ();
+    disableIRQ();
+}
+
+static void frameInterrupt(void) {
+    (void)AT91C_BASE_TC0->TC_SR; // acknowledge the RC compare
+    ticks++;
+    if (ready) {
+        if (present)
+            present();
+        presented = ticks;
+        frameStats.frames++;
+        ready = FALSE;
+    }
+}
+
+#ifdef PROFILE
+static void cycleOverflow(void) {
+    (void)AT91C_BASE_TC1->TC_SR; // acknowledge the overflow
+    cycleHigh++;
+}
+#endif
 
 /* Configure timers */
 void initTimers(void) {
-    AT91F_PMC_EnablePeriphClock(AT91C_BASE_PMC, 1 << AT91C_ID_TC0);// Enable TC0
-    *AT91C_TC0_CMR = AT91C_TC_CLKS_TIMER_DIV5_CLOCK; // DIV1 = MCK/2 clock speed (MCK = 18.432 KHz?)
-    *AT91C_TC0_CCR = AT91C_TC_CLKEN; // Enable clock
-    *AT91C_TC0_CCR = AT91C_TC_SWTRG; // Reset clock
+    AT91PS_TC pTC0 = AT91C_BASE_TC0;
+    AT91PS_TC pTC1 = AT91C_BASE_TC1;
+
+    AT91F_PMC_EnablePeriphClock(AT91C_BASE_PMC, (1 << AT91C_ID_TC0) | (1 << AT91C_ID_TC1));
+
+    // TC0: counts up to RC, interrupts and starts again
+    pTC0->TC_CCR = AT91C_TC_CLKDIS;
+    pTC0->TC_IDR = 0xFFFFFFFF;
+    pTC0->TC_CMR = AT91C_TC_CLKS_TIMER_DIV3_CLOCK | AT91C_TC_WAVE | AT91C_TC_WAVESEL_UP_AUTO;
+    AT91F_AIC_ConfigureIt(AT91C_ID_TC0, FRAME_PRIORITY, AT91C_AIC_SRCTYPE_INT_HIGH_LEVEL, frameInterrupt);
+
+    // TC1: free running, wraps every 2.7ms; with PROFILE the overflow
+    // interrupt extends it to 32 bits for cycleCount()
+    pTC1->TC_CCR = AT91C_TC_CLKDIS;
+    pTC1->TC_IDR = 0xFFFFFFFF;
+    pTC1->TC_CMR = AT91C_TC_CLKS_TIMER_DIV1_CLOCK;
+#ifdef PROFILE
+    AT91F_AIC_ConfigureIt(AT91C_ID_TC1, AT91C_AIC_PRIOR_LOWEST, AT91C_AIC_SRCTYPE_INT_HIGH_LEVEL, cycleOverflow);
+    pTC1->TC_IER = AT91C_TC_COVFS;
+    AT91C_BASE_AIC->AIC_IECR = 1 << AT91C_ID_TC1;
+#endif
+    pTC1->TC_CCR = AT91C_TC_CLKEN | AT91C_TC_SWTRG;
+
+    enableIRQ();
 }
 
 /* Delay for a period time */
 void busyWait(uint32 delay) {
-    // todo: something isn't right here
-    //while (*AT91C_TC0_CV <= delay)
-        //continue;
-    //*AT91C_TC0_CCR = AT91C_TC_SWTRG;
-    uint32 j;
-    for (j = 0; j < delay; j++) {
-        nop(); // nop~=0.125uS
+    // CYCLE_CLOCK/100 is a whole number of ticks per 10ms
+    uint32 wait = (delay / 10000) * (CYCLE_CLOCK / 100) +
+            (delay % 10000) * (CYCLE_CLOCK / 100) / 10000;
+    uint16 last = AT91C_BASE_TC1->TC_CV;
+
+    while (wait) {
+        uint16 now = AT91C_BASE_TC1->TC_CV;
+        uint16 elapsed = now - last;
+        last = now;
+        wait = elapsed < wait ? wait - elapsed : 0;
     }
 }
+
+#ifdef PROFILE
+uint32 cycleCount(void) {
+    uint32 high, low, pending;
+
+    do {
+        high = cycleHigh;
+        low = AT91C_BASE_TC1->TC_CV;
+        pending = AT91C_BASE_AIC->AIC_IPR & (1 << AT91C_ID_TC1);
+    } while (high != cycleHigh);
+
+    // An overflow the interrupt has not counted yet, with IRQs masked or a
+    // higher priority handler running
+    if (pending && low < 0x8000)
+        high++;
+    return ((high << 16) | low) * (MCK / CYCLE_CLOCK);
+}
+#endif
+
+void startFrames(uint16 rate, void (*callback)(void)) {
+    AT91PS_TC pTC0 = AT91C_BASE_TC0;
+
+    stopFrames();
+    present = callback;
+    ready = FALSE;
+    ticks = 0;
+    presented = 0;
+    frameStats.frames = 0;
+    frameStats.overruns = 0;
+
+    pTC0->TC_RC = TIMER_CLOCK / rate;
+    pTC0->TC_IER = AT91C_TC_CPCS;
+    AT91C_BASE_AIC->AIC_IECR = 1 << AT91C_ID_TC0;
+    pTC0->TC_CCR = AT91C_TC_CLKEN | AT91C_TC_SWTRG;
+}
+
+void stopFrames(void) {
+    AT91C_BASE_AIC->AIC_IDCR = 1 << AT91C_ID_TC0;
+    AT91C_BASE_TC0->TC_IDR = AT91C_TC_CPCS;
+    AT91C_BASE_TC0->TC_CCR = AT91C_TC_CLKDIS;
+    ready = FALSE;
+}
+
+void nextFrame(void) {
+    PROFILE_FRAME();
+
+    // Every tick since the last frame was presented was a missed slot
+    uint32 now = ticks;
+    if (now > presented)
+        frameStats.overruns += now - presented;
+
+    disableIRQ();
+    ready = TRUE;
+    while (ready)
+        sleep();
+    enableIRQ();
+}
+
+void waitFrames(uint32 count) {
+    uint32 end = ticks + count;
+    disableIRQ();
+    while ((int32)(ticks - end) < 0)
+        sleep();
+    presented = ticks;
+    enableIRQ();
+}
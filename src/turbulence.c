@@ -0,0 +1,72 @@
+/*
+ * turbulence.c
+ *
+ * Infinite phase screen extrusion, see turbulence.h. Each row is
+ * AR_COLS*(AR_STENCIL + (AR_COLS+1)/2) multiply-accumulates, all on 64 bit
+ * accumulators (SMLAL) so the coefficient scaling cannot overflow.
+ *
+ * John Howe 2010
+ */
+
+#include "turbulence.h"
+
+static int32 history[AR_DEPTH][AR_COLS]; // history[0] is the newest row
+static uint32 state;
+
+/* xorshift32. The masks are free on the ARM and keep the host builds,
+ * where uint32 may be wider, on the same sequence. */
+static inline uint32 randomWord (void)
+{
+    state ^= (state << 13) & 0xFFFFFFFF;
+    state ^= state >> 17;
+    state ^= (state << 5) & 0xFFFFFFFF;
+    return state;
+}
+
+int32 arNoise (void)
+{
+    uint32 a = randomWord ();
+    uint32 b = randomWord ();
+    return (int32)((a & 0xFFFF) + (a >> 16) + (b & 0xFFFF) + (b >> 16)) - 2*0xFFFF;
+}
+
+void startTurbulence (uint32 seed)
+{
+    state = seed ? seed : 1;
+    for (int d = 0; d < AR_DEPTH; d++)
+        for (int i = 0; i < AR_COLS; i++)
+            history[d][i] = 0;
+    // Settle, so the first row shown already has the full covariance
+    int32 row[AR_COLS];
+    for (int i = 0; i < 4*AR_COLS; i++)
+        nextTurbulence (row);
+}
+
+void nextTurbulence (int32 *row)
+{
+    int32 noise[AR_COLS];
+    for (int i = 0; i < AR_COLS; i++)
+        noise[i] = arNoise ();
+
+    const int16 *b = arB;
+    for (int i = 0; i < AR_COLS; i++)
+    {
+        const int16 *a = arA[i];
+        const int32 *z = &history[0][0];
+        long long sum = 0;
+        for (int j = 0; j < AR_STENCIL; j++)
+            sum += (long long)a[j] * z[j];
+
+        long long random = 0;
+        for (int j = 0; j <= i; j++)
+            random += (long long)*b++ * noise[j];
+
+        row[i] = (int32)(sum >> arAShift) + (int32)(random >> arBShift);
+    }
+
+    for (int d = AR_DEPTH-1; d > 0; d--)
+        for (int i = 0; i < AR_COLS; i++)
+            history[d][i] = history[d-1][i];
+    for (int i = 0; i < AR_COLS; i++)
+        history[0][i] = row[i];
+}
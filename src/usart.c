@@ -0,0 +1,94 @@
+/*
+ * usart.c
+ *
+ * USART0 frame receiver. The PDC receives into two buffers: while one is
+ * being filled (RPR/RCR) the other is queued behind it (RNPR/RNCR), so
+ * reception never stops and the CPU never handles single characters. When
+ * a buffer completes, pollUSART() passes it to parseLink() and queues it
+ * again behind the one now being filled. The receiver time-out catches the
+ * tail of a frame that does not fill a whole buffer.
+ *
+ * John Howe 2010
+ */
+
+#include "Board.h"
+#include "slimLib.h"
+#include "usart.h"
+
+// Fractional part of the baud rate divisor (US_BRGR bits 16-18)
+#define US_FP(n)    ((n) << 16)
+
+uint8 usartBuffer[2][USART_CHUNK] __attribute__ ((aligned (4)));
+
+static uint8 current = 0; // buffer being filled
+static uint16 consumed = 0; // bytes of it already parsed
+
+void initUSART (void)
+{
+    AT91PS_USART pUS = AT91C_BASE_US0;
+    AT91PS_PDC pPDC = AT91C_BASE_PDC_US0;
+
+    AT91F_PMC_EnablePeriphClock (AT91C_BASE_PMC, 1 << AT91C_ID_US0);
+
+    // Hand RXD0 to the USART (peripheral A)
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    pPIO->PIO_ASR = US_RXD_PIN;
+    pPIO->PIO_PDR = US_RXD_PIN;
+
+    pUS->US_CR = AT91C_US_RSTRX | AT91C_US_RSTSTA;
+    pUS->US_MR = AT91C_US_USMODE_NORMAL | AT91C_US_CLKS_CLOCK |
+            AT91C_US_CHRL_8_BITS | AT91C_US_PAR_NONE |
+            AT91C_US_NBSTOP_1_BIT | AT91C_US_OVER;
+    // 8x oversampling: MCK / (8 * 6.5) = 921600 exactly
+    pUS->US_BRGR = 6 | US_FP(4);
+    pUS->US_RTOR = USART_TIMEOUT;
+
+    pPDC->PDC_RPR = (uint32)usartBuffer[0];
+    pPDC->PDC_RCR = USART_CHUNK;
+    pPDC->PDC_RNPR = (uint32)usartBuffer[1];
+    pPDC->PDC_RNCR = USART_CHUNK;
+    pPDC->PDC_PTCR = AT91C_PDC_RXTEN;
+    current = 0;
+    consumed = 0;
+
+    pUS->US_CR = AT91C_US_RXEN | AT91C_US_STTTO;
+}
+
+void pollUSART (void)
+{
+    AT91PS_USART pUS = AT91C_BASE_US0;
+    AT91PS_PDC pPDC = AT91C_BASE_PDC_US0;
+
+    if (pUS->US_CSR & AT91C_US_ENDRX)
+    {
+        // The PDC has moved on to the queued buffer; finish this one and
+        // queue it again (writing RNCR clears ENDRX)
+        parseLink (usartBuffer[current] + consumed, USART_CHUNK - consumed);
+        pPDC->PDC_RNPR = (uint32)usartBuffer[current];
+        pPDC->PDC_RNCR = USART_CHUNK;
+        current ^= 1;
+        consumed = 0;
+    }
+
+    if (pUS->US_CSR & AT91C_US_TIMEOUT)
+    {
+        // Line idle: parse what has arrived in the buffer being filled.
+        // If it completed meanwhile, leave it for ENDRX next time.
+        uint16 filled = USART_CHUNK - pPDC->PDC_RCR;
+        if (!(pUS->US_CSR & AT91C_US_ENDRX) && filled > consumed)
+        {
+            parseLink (usartBuffer[current] + consumed, filled - consumed);
+            consumed = filled;
+        }
+        pUS->US_CR = AT91C_US_STTTO;
+    }
+}
+
+void usartLoop (void)
+{
+    initUSART ();
+    for (;;)
+    {
+        pollUSART ();
+    }
+}
@@ -0,0 +1,321 @@
+/*
+ * usb.c
+ *
+ * USB CDC-ACM device on the UDP, receiving frames from the PC. The PC sees
+ * a virtual serial port; everything written to it arrives on EP_OUT and is
+ * passed to parseLink(). Enumeration follows Atmel's AT91SAM7S CDC example.
+ *
+ * The UDP is polled rather than interrupt driven so that reception and LCD
+ * output never preempt each other: pollUSB() draws one bank while the UDP
+ * receives into the other.
+ *
+ * John Howe 2010
+ */
+
+#include "Board.h"
+#include "slimLib.h"
+#include "usb.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// (bRequest << 8) | bmRequestType of the supported setup requests
+#define STD_GET_DESCRIPTOR              0x0680
+#define STD_SET_ADDRESS                 0x0500
+#define STD_SET_CONFIGURATION           0x0900
+#define STD_GET_CONFIGURATION           0x0880
+#define STD_GET_STATUS_ZERO             0x0080
+#define STD_GET_STATUS_INTERFACE        0x0081
+#define STD_GET_STATUS_ENDPOINT         0x0082
+#define STD_CLEAR_FEATURE_ZERO          0x0100
+#define STD_CLEAR_FEATURE_INTERFACE     0x0101
+#define STD_CLEAR_FEATURE_ENDPOINT      0x0102
+#define STD_SET_FEATURE_ZERO            0x0300
+#define STD_SET_FEATURE_INTERFACE       0x0301
+#define STD_SET_FEATURE_ENDPOINT        0x0302
+#define SET_LINE_CODING                 0x2021
+#define GET_LINE_CODING                 0x21A1
+#define SET_CONTROL_LINE_STATE          0x2221
+
+static const uint8 devDescriptor[] = {
+    0x12,               // bLength
+    0x01,               // bDescriptorType: device
+    0x10, 0x01,         // bcdUSB 1.1
+    0x02,               // bDeviceClass: CDC
+    0x00,               // bDeviceSubclass
+    0x00,               // bDeviceProtocol
+    0x08,               // bMaxPacketSize0
+    0xEB, 0x03,         // idVendor: Atmel
+    0x24, 0x61,         // idProduct: AT91 USB CDC
+    0x10, 0x01,         // bcdDevice
+    0x00,               // iManufacturer
+    0x00,               // iProduct
+    0x00,               // iSerialNumber
+    0x01                // bNumConfigurations
+};
+
+static const uint8 cfgDescriptor[] = {
+    // Configuration
+    0x09, 0x02, 0x43, 0x00, 0x02, 0x01, 0x00, 0x80, 0x32,
+    // Communication class interface
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x02, 0x02, 0x00, 0x00,
+    // Header functional descriptor
+    0x05, 0x24, 0x00, 0x10, 0x01,
+    // Call management functional descriptor
+    0x05, 0x24, 0x01, 0x00, 0x01,
+    // ACM functional descriptor
+    0x04, 0x24, 0x02, 0x00,
+    // Union functional descriptor
+    0x05, 0x24, 0x06, 0x00, 0x01,
+    // EP_NOTIFY: interrupt IN
+    0x07, 0x05, 0x80 | EP_NOTIFY, 0x03, 0x08, 0x00, 0xFF,
+    // Data class interface
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x00,
+    // EP_OUT: bulk OUT
+    0x07, 0x05, EP_OUT, 0x02, EP_OUT_SIZE, 0x00, 0x00,
+    // EP_IN: bulk IN
+    0x07, 0x05, 0x80 | EP_IN, 0x02, 0x40, 0x00, 0x00
+};
+
+// 115200 8N1, reported back to the host but otherwise meaningless
+static uint8 lineCoding[7] = { 0x00, 0xC2, 0x01, 0x00, 0x00, 0x00, 0x08 };
+
+static uint8 configuration = 0;
+static uint32 currentBank = AT91C_UDP_RX_DATA_BK0;
+
+// One bank of EP_OUT, word aligned for streamPixels()
+static uint8 packet[EP_OUT_SIZE] __attribute__ ((aligned (4)));
+
+static void sendData (const uint8 *data, uint16 length)
+{
+    AT91PS_UDP pUDP = AT91C_BASE_UDP;
+    uint32 csr;
+
+    do {
+        uint16 count = MIN(length, 8);
+        length -= count;
+        while (count--)
+            pUDP->UDP_FDR[EP_CONTROL] = *data++;
+
+        if (pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_TXCOMP)
+        {
+            pUDP->UDP_CSR[EP_CONTROL] &= ~AT91C_UDP_TXCOMP;
+            while (pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_TXCOMP);
+        }
+        pUDP->UDP_CSR[EP_CONTROL] |= AT91C_UDP_TXPKTRDY;
+
+        do {
+            csr = pUDP->UDP_CSR[EP_CONTROL];
+            // Data IN stage has been stopped by a status OUT
+            if (csr & AT91C_UDP_RX_DATA_BK0)
+            {
+                pUDP->UDP_CSR[EP_CONTROL] &= ~AT91C_UDP_RX_DATA_BK0;
+                return;
+            }
+        } while (!(csr & AT91C_UDP_TXCOMP));
+    } while (length);
+
+    if (pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_TXCOMP)
+    {
+        pUDP->UDP_CSR[EP_CONTROL] &= ~AT91C_UDP_TXCOMP;
+        while (pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_TXCOMP);
+    }
+}
+
+static void sendZLP (void)
+{
+    AT91PS_UDP pUDP = AT91C_BASE_UDP;
+    pUDP->UDP_CSR[EP_CONTROL] |= AT91C_UDP_TXPKTRDY;
+    while (!(pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_TXCOMP));
+    pUDP->UDP_CSR[EP_CONTROL] &= ~AT91C_UDP_TXCOMP;
+    while (pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_TXCOMP);
+}
+
+static void sendStall (void)
+{
+    AT91PS_UDP pUDP = AT91C_BASE_UDP;
+    pUDP->UDP_CSR[EP_CONTROL] |= AT91C_UDP_FORCESTALL;
+    while (!(pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_ISOERROR));
+    pUDP->UDP_CSR[EP_CONTROL] &= ~(AT91C_UDP_FORCESTALL | AT91C_UDP_ISOERROR);
+    while (pUDP->UDP_CSR[EP_CONTROL] & (AT91C_UDP_FORCESTALL | AT91C_UDP_ISOERROR));
+}
+
+static void configureEndpoints (uint8 enable)
+{
+    AT91PS_UDP pUDP = AT91C_BASE_UDP;
+    pUDP->UDP_CSR[EP_OUT] = enable ? (AT91C_UDP_EPEDS | AT91C_UDP_EPTYPE_BULK_OUT) : 0;
+    pUDP->UDP_CSR[EP_IN] = enable ? (AT91C_UDP_EPEDS | AT91C_UDP_EPTYPE_BULK_IN) : 0;
+    pUDP->UDP_CSR[EP_NOTIFY] = enable ? (AT91C_UDP_EPEDS | AT91C_UDP_EPTYPE_INT_IN) : 0;
+    currentBank = AT91C_UDP_RX_DATA_BK0;
+}
+
+static void handleSetup (void)
+{
+    AT91PS_UDP pUDP = AT91C_BASE_UDP;
+    uint16 status = 0;
+
+    if (!(pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_RXSETUP))
+        return;
+
+    uint8 requestType = pUDP->UDP_FDR[EP_CONTROL];
+    uint8 request = pUDP->UDP_FDR[EP_CONTROL];
+    uint16 value = pUDP->UDP_FDR[EP_CONTROL] & 0xFF;
+    value |= pUDP->UDP_FDR[EP_CONTROL] << 8;
+    uint16 index = pUDP->UDP_FDR[EP_CONTROL] & 0xFF;
+    index |= pUDP->UDP_FDR[EP_CONTROL] << 8;
+    uint16 length = pUDP->UDP_FDR[EP_CONTROL] & 0xFF;
+    length |= pUDP->UDP_FDR[EP_CONTROL] << 8;
+
+    if (requestType & 0x80)
+    {
+        pUDP->UDP_CSR[EP_CONTROL] |= AT91C_UDP_DIR;
+        while (!(pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_DIR));
+    }
+    pUDP->UDP_CSR[EP_CONTROL] &= ~AT91C_UDP_RXSETUP;
+    while (pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_RXSETUP);
+
+    switch ((request << 8) | requestType)
+    {
+        case STD_GET_DESCRIPTOR:
+            if (value == 0x100)
+                sendData (devDescriptor, MIN(sizeof(devDescriptor), length));
+            else if (value == 0x200)
+                sendData (cfgDescriptor, MIN(sizeof(cfgDescriptor), length));
+            else
+                sendStall ();
+            break;
+        case STD_SET_ADDRESS:
+            sendZLP ();
+            pUDP->UDP_FADDR = AT91C_UDP_FEN | value;
+            pUDP->UDP_GLBSTATE = value ? AT91C_UDP_FADDEN : 0;
+            break;
+        case STD_SET_CONFIGURATION:
+            configuration = value;
+            sendZLP ();
+            pUDP->UDP_GLBSTATE = value ? AT91C_UDP_CONFG : AT91C_UDP_FADDEN;
+            configureEndpoints (value != 0);
+            break;
+        case STD_GET_CONFIGURATION:
+            sendData (&configuration, sizeof(configuration));
+            break;
+        case STD_GET_STATUS_ZERO:
+        case STD_GET_STATUS_INTERFACE:
+            sendData ((uint8 *)&status, sizeof(status));
+            break;
+        case STD_GET_STATUS_ENDPOINT:
+            index &= 0x0F;
+            if (((pUDP->UDP_GLBSTATE & AT91C_UDP_CONFG) && index <= EP_NOTIFY) ||
+                    ((pUDP->UDP_GLBSTATE & AT91C_UDP_FADDEN) && index == 0))
+            {
+                status = (pUDP->UDP_CSR[index] & AT91C_UDP_EPEDS) ? 0 : 1;
+                sendData ((uint8 *)&status, sizeof(status));
+            }
+            else
+                sendStall ();
+            break;
+        case STD_SET_FEATURE_INTERFACE:
+        case STD_CLEAR_FEATURE_INTERFACE:
+            sendZLP ();
+            break;
+        case STD_SET_FEATURE_ENDPOINT:
+            index &= 0x0F;
+            if (value == 0 && index && index <= EP_NOTIFY)
+            {
+                pUDP->UDP_CSR[index] = 0;
+                sendZLP ();
+            }
+            else
+                sendStall ();
+            break;
+        case STD_CLEAR_FEATURE_ENDPOINT:
+            index &= 0x0F;
+            if (value == 0 && index && index <= EP_NOTIFY)
+            {
+                configureEndpoints (TRUE);
+                sendZLP ();
+            }
+            else
+                sendStall ();
+            break;
+        case SET_LINE_CODING:
+            while (!(pUDP->UDP_CSR[EP_CONTROL] & AT91C_UDP_RX_DATA_BK0));
+            for (int i = 0; i < sizeof(lineCoding); i++)
+                lineCoding[i] = pUDP->UDP_FDR[EP_CONTROL];
+            pUDP->UDP_CSR[EP_CONTROL] &= ~AT91C_UDP_RX_DATA_BK0;
+            sendZLP ();
+            break;
+        case GET_LINE_CODING:
+            sendData (lineCoding, MIN(sizeof(lineCoding), length));
+            break;
+        case SET_CONTROL_LINE_STATE:
+            sendZLP ();
+            break;
+        default:
+            sendStall ();
+            break;
+    }
+}
+
+void initUSB (void)
+{
+    // 48 MHz UDP clock from the PLL (see InitController)
+    AT91C_BASE_PMC->PMC_SCER = AT91C_PMC_UDP;
+    AT91F_PMC_EnablePeriphClock (AT91C_BASE_PMC, 1 << AT91C_ID_UDP);
+
+    // Connect the D+ pull-up so the host sees the device
+    volatile AT91PS_PIO pPIO = AT91C_BASE_PIOA;
+    pPIO->PIO_PER = PUSBPUP;
+    pPIO->PIO_OER = PUSBPUP;
+    pPIO->PIO_CODR = PUSBPUP;
+}
+
+uint8 usbConfigured (void)
+{
+    return (AT91C_BASE_UDP->UDP_GLBSTATE & AT91C_UDP_CONFG) != 0;
+}
+
+void pollUSB (void)
+{
+    AT91PS_UDP pUDP = AT91C_BASE_UDP;
+    uint32 isr = pUDP->UDP_ISR;
+
+    if (isr & AT91C_UDP_ENDBUSRES)
+    {
+        pUDP->UDP_ICR = AT91C_UDP_ENDBUSRES;
+        // Reset all endpoints and enable the function at address 0
+        pUDP->UDP_RSTEP = AT91C_UDP_EP0 | AT91C_UDP_EP1 | AT91C_UDP_EP2 | AT91C_UDP_EP3;
+        pUDP->UDP_RSTEP = 0;
+        pUDP->UDP_FADDR = AT91C_UDP_FEN;
+        pUDP->UDP_CSR[EP_CONTROL] = AT91C_UDP_EPEDS | AT91C_UDP_EPTYPE_CTRL;
+        configuration = 0;
+        return;
+    }
+
+    if (isr & AT91C_UDP_EPINT0)
+    {
+        pUDP->UDP_ICR = AT91C_UDP_EPINT0;
+        handleSetup ();
+    }
+
+    // Banks are filled alternately by the UDP, so always empty the older one
+    if (pUDP->UDP_CSR[EP_OUT] & currentBank)
+    {
+        uint16 count = (pUDP->UDP_CSR[EP_OUT] & AT91C_UDP_RXBYTECNT) >> 16;
+        for (int i = 0; i < count; i++)
+            packet[i] = pUDP->UDP_FDR[EP_OUT];
+
+        // Hand the bank back before drawing, so the UDP can refill it
+        pUDP->UDP_CSR[EP_OUT] &= ~currentBank;
+        currentBank ^= AT91C_UDP_RX_DATA_BK0 | AT91C_UDP_RX_DATA_BK1;
+
+        parseLink (packet, count);
+    }
+}
+
+void usbLoop (void)
+{
+    initUSB ();
+    for (;;)
+    {
+        pollUSB ();
+    }
+}
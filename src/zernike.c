@@ -0,0 +1,182 @@
+/*
+ * zernike.c
+ *
+ * Aberration patterns by forward differencing, see zernike.h.
+ *
+ * The weighted sum is a polynomial P(x, y) of degree ZERNIKE_DEGREE in the
+ * pixel coordinates. Its coefficients are rounded to integers once per
+ * frame, so P is integer valued on the pixel grid and its forward
+ * differences are exact: stepping along a row or down a column by
+ * additions gives exactly what evaluating P would, however far it goes.
+ *
+ * Along a row the fourth difference in x is constant, so a pixel is four
+ * additions. The differences at the start of each row are polynomials in y
+ * of lower degree, stepped down the panel the same way, ten additions a
+ * row.
+ *
+ * John Howe 2010
+ */
+
+#include "zernike.h"
+#include "lcd.h"
+#include "aperture.h"
+
+#define ORDERS  (ZERNIKE_DEGREE + 1)
+
+/* Each term as k u^i v^j parts */
+static const struct {
+    uint8 term, i, j;
+    int8 k;
+} expansion[] = {
+    { ZERNIKE_PISTON,    0, 0,  1 },
+    { ZERNIKE_TILT_X,    1, 0,  1 },
+    { ZERNIKE_TILT_Y,    0, 1,  1 },
+    { ZERNIKE_DEFOCUS,   2, 0,  2 },
+    { ZERNIKE_DEFOCUS,   0, 2,  2 },
+    { ZERNIKE_DEFOCUS,   0, 0, -1 },
+    { ZERNIKE_ASTIG_0,   2, 0,  1 },
+    { ZERNIKE_ASTIG_0,   0, 2, -1 },
+    { ZERNIKE_ASTIG_45,  1, 1,  2 },
+    { ZERNIKE_COMA_X,    3, 0,  3 },
+    { ZERNIKE_COMA_X,    1, 2,  3 },
+    { ZERNIKE_COMA_X,    1, 0, -2 },
+    { ZERNIKE_COMA_Y,    2, 1,  3 },
+    { ZERNIKE_COMA_Y,    0, 3,  3 },
+    { ZERNIKE_COMA_Y,    0, 1, -2 },
+    { ZERNIKE_SPHERICAL, 4, 0,  6 },
+    { ZERNIKE_SPHERICAL, 2, 2, 12 },
+    { ZERNIKE_SPHERICAL, 0, 4,  6 },
+    { ZERNIKE_SPHERICAL, 2, 0, -6 },
+    { ZERNIKE_SPHERICAL, 0, 2, -6 },
+    { ZERNIKE_SPHERICAL, 0, 0,  1 },
+};
+
+static uint8 pupilX = LCD_WIDTH/2, pupilY = LCD_HEIGHT/2, pupilRadius = LCD_HEIGHT/2;
+
+// P(x, y) = sum of coefficient[i][j] (x - pupilX)^i (y - pupilY)^j
+static long long coefficient[ORDERS][ORDERS];
+
+// start[k][m] is the m-th difference in y of the k-th difference in x, at
+// pixel (0, 0). rowDiff[][] is the same for the row being drawn.
+static long long start[ORDERS][ORDERS];
+static long long rowDiff[ORDERS][ORDERS];
+static uint8 diffRow;
+
+static uint8 line[LCD_WIDTH];
+
+/* Replaces v[0..ZERNIKE_DEGREE] with its forward differences at 0 */
+static void differences (long long *v)
+{
+    for (int order = 1; order < ORDERS; order++)
+        for (int t = ZERNIKE_DEGREE; t >= order; t--)
+            v[t] -= v[t-1];
+}
+
+void setZernikePupil (uint8 x, uint8 y, uint8 radius)
+{
+    pupilX = x;
+    pupilY = y;
+    pupilRadius = radius ? radius : 1;
+}
+
+long long zernikePhase (uint8 x, uint8 y)
+{
+    long long dx = (int16)x - pupilX, dy = (int16)y - pupilY;
+    long long sum = 0;
+
+    for (int i = ZERNIKE_DEGREE; i >= 0; i--)
+    {
+        long long column = 0;
+        for (int j = ZERNIKE_DEGREE - i; j >= 0; j--)
+            column = column * dy + coefficient[i][j];
+        sum = sum * dx + column;
+    }
+    return sum;
+}
+
+void setZernike (const int16 *weights)
+{
+    long long sum[ORDERS][ORDERS] = { { 0 } };
+
+    for (uint8 n = 0; n < sizeof(expansion)/sizeof(expansion[0]); n++)
+        sum[expansion[n].i][expansion[n].j] += expansion[n].k * weights[expansion[n].term];
+
+    // u = (x - pupilX)/R, so u^i v^j brings in 1/R^(i+j)
+    for (int i = 0; i < ORDERS; i++)
+    {
+        for (int j = 0; i + j < ORDERS; j++)
+        {
+            long long scale = 1;
+            for (int p = 0; p < i + j; p++)
+                scale *= pupilRadius;
+            long long c = sum[i][j] * (1LL << (ZERNIKE_SHIFT - 8));
+            c += c < 0 ? -scale/2 : scale/2;
+            coefficient[i][j] = c / scale;
+        }
+    }
+
+    // Differences in x at x = 0 on rows 0 to ZERNIKE_DEGREE, then their
+    // differences down the rows
+    long long grid[ORDERS][ORDERS];
+    for (int y = 0; y < ORDERS; y++)
+    {
+        long long v[ORDERS];
+        for (int x = 0; x < ORDERS; x++)
+            v[x] = zernikePhase (x, y);
+        differences (v);
+        for (int k = 0; k < ORDERS; k++)
+            grid[k][y] = v[k];
+    }
+    for (int k = 0; k < ORDERS; k++)
+    {
+        differences (grid[k]);
+        for (int m = 0; m < ORDERS; m++)
+            start[k][m] = grid[k][m];
+    }
+}
+
+/* Steps the row differences down one row */
+static void nextRow (void)
+{
+    for (int k = 0; k < ORDERS; k++)
+        for (int m = 0; m < ZERNIKE_DEGREE - k; m++)
+            rowDiff[k][m] += rowDiff[k][m+1];
+    diffRow++;
+}
+
+static void zernikeRow (uint8 row, uint8 startCol, uint8 endCol)
+{
+    while (diffRow < row)
+        nextRow ();
+
+    long long p = rowDiff[0][0], d1 = rowDiff[1][0], d2 = rowDiff[2][0];
+    long long d3 = rowDiff[3][0], d4 = rowDiff[4][0];
+    uint8 x = 0, first = 3*startCol, end = 3*endCol;
+
+    // Pixels left of the aperture still have to be stepped over
+    for (; x < first; x++)
+    {
+        p += d1;
+        d1 += d2;
+        d2 += d3;
+        d3 += d4;
+    }
+    for (; x < end; x++)
+    {
+        line[x] = ZERNIKE_SHADE (p) << 3;
+        p += d1;
+        d1 += d2;
+        d2 += d3;
+        d3 += d4;
+    }
+    streamPixels (line + first, end - first);
+}
+
+void drawZernike (void)
+{
+    for (int k = 0; k < ORDERS; k++)
+        for (int m = 0; m < ORDERS; m++)
+            rowDiff[k][m] = start[k][m];
+    diffRow = 0;
+    drawAperture (zernikeRow);
+}
@@ -0,0 +1,217 @@
+/*
+ * fixcheck.c
+ *
+ * Runs the firmware's fixed point maths (fixmath.c with the generated
+ * fixtables.c) on the PC, checks it against libm and times both.
+ *
+ *   fixcheck [-n calls]
+ *
+ *   -n calls   calls to time of each function (10000000)
+ *
+ * Exits non-zero if any function is less accurate than fixmath.h
+ * promises. The times are for the PC, only useful relative to libm.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "fixmath.h"
+
+static int fail;
+
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void report (const char *name, double error, double limit, const char *unit)
+{
+    int ok = error <= limit;
+    printf ("%-8s worst %8.3f %-12s limit %6.2f  %s\n", name, error, unit, limit, ok ? "ok" : "FAIL");
+    if (!ok)
+        fail = 1;
+}
+
+/* Difference of two phases in turns units, -32768 to 32767 */
+static double phaseError (double a, double b)
+{
+    double d = fmod (a - b, FIX_TURN);
+    if (d > FIX_TURN/2)
+        d -= FIX_TURN;
+    if (d < -FIX_TURN/2)
+        d += FIX_TURN;
+    return fabs (d);
+}
+
+static double inverseNormal (double p)
+{
+    double lo = -40, hi = 40;
+    for (int i = 0; i < 100; i++)
+    {
+        double mid = (lo + hi) / 2;
+        if (0.5 * erfc (-mid / M_SQRT2) < p)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+static void checkTrig (void)
+{
+    double worst = 0;
+    for (long p = 0; p < FIX_TURN; p++)
+    {
+        double s = FIX_ONE * sin (2 * M_PI * p / FIX_TURN);
+        double c = FIX_ONE * cos (2 * M_PI * p / FIX_TURN);
+        worst = fmax (worst, fabs (fixSin (p) - s));
+        worst = fmax (worst, fabs (fixCos (p) - c));
+    }
+    report ("sin/cos", worst, 2, "Q15 lsb");
+}
+
+static void checkAtan2 (void)
+{
+    double worst = 0;
+    for (long y = -1000; y <= 1000; y += 3)
+    {
+        for (long x = -1000; x <= 1000; x += 3)
+        {
+            if (x == 0 && y == 0)
+                continue;
+            double exact = atan2 (y, x) / (2 * M_PI) * FIX_TURN;
+            worst = fmax (worst, phaseError (fixAtan2 (y, x), exact));
+        }
+    }
+    // Large vectors all the way round
+    for (long p = 0; p < FIX_TURN; p += 7)
+    {
+        double a = 2 * M_PI * p / FIX_TURN;
+        long x = lround (8000000 * cos (a)), y = lround (8000000 * sin (a));
+        worst = fmax (worst, phaseError (fixAtan2 (y, x), atan2 (y, x) / (2 * M_PI) * FIX_TURN));
+    }
+    report ("atan2", worst, 1, "turn/65536");
+}
+
+static void checkSqrt (void)
+{
+    long bad = 0;
+    srand (1);
+    for (uint32 x = 0; x < (1 << 24); x++)
+        if (fixSqrt (x) != (uint32)sqrt (x))
+            bad++;
+    for (long i = 0; i < 1000000; i++)
+    {
+        uint32 x = ((uint32)rand () << 16 ^ (uint32)rand ()) & 0xFFFFFFFF;
+        if (fixSqrt (x) != (uint32)sqrt (x))
+            bad++;
+    }
+    // Either side of every square
+    for (uint32 r = 1; r < 65536; r++)
+    {
+        if (fixSqrt (r*r) != r || fixSqrt (r*r - 1) != r - 1)
+            bad++;
+    }
+    if (fixSqrt (0xFFFFFFFF) != 0xFFFF)
+        bad++;
+    report ("sqrt", bad, 0, "wrong");
+}
+
+static void checkGauss (void)
+{
+    double sum = 0, sum2 = 0, worst = 0, tails = 0;
+    for (long u = 0; u < FIX_TURN; u++)
+    {
+        double g = fixGauss (u) / (double)FIX_GAUSS_ONE;
+        sum += g;
+        sum2 += g * g;
+        // The outermost entries are cut at GAUSS_LIMIT and interpolated
+        // across, so are left out. The curve is steepest next to them.
+        long edge = u < FIX_TURN/2 ? u : FIX_TURN - 1 - u;
+        double error = fabs (g - inverseNormal ((u + 0.5) / FIX_TURN));
+        if (edge >= FIX_TURN/100)
+            worst = fmax (worst, error);
+        else if (edge >= FIX_TURN/GAUSS_ENTRIES)
+            tails = fmax (tails, error);
+    }
+    double mean = sum / FIX_TURN;
+    double deviation = sqrt (sum2 / FIX_TURN - mean * mean);
+    report ("gauss", worst, 0.01, "deviations");
+    report ("  tails", tails, 0.02, "deviations");
+    report ("  mean", fabs (mean), 0.001, "deviations");
+    report ("  sd", fabs (deviation - 1), 0.01, "off 1");
+}
+
+static void checkDither (void)
+{
+    double worst = 0;
+    // Every phase below the last shade, which wraps to 0 when dithered up
+    for (long p = 0; p < FIX_TURN - (FIX_TURN >> 5); p++)
+    {
+        long total = 0;
+        for (int y = 0; y < DITHER_SIZE; y++)
+            for (int x = 0; x < DITHER_SIZE; x++)
+                total += fixShade (p, x, y);
+        double mean = (double)total / (DITHER_SIZE * DITHER_SIZE);
+        worst = fmax (worst, fabs (mean - (double)p / (1 << FIX_SHADE_SHIFT)));
+    }
+    report ("dither", worst, 1.0 / (DITHER_SIZE * DITHER_SIZE), "shades");
+}
+
+volatile double sinkD;
+volatile int32 sinkI;
+
+/* Times fix against its libm equivalent over the same arguments */
+#define TIME(name, calls, fix, libm) do { \
+    double t0 = now (); \
+    for (long i = 0; i < calls; i++) \
+        sinkI = fix; \
+    double t1 = now (); \
+    for (long i = 0; i < calls; i++) \
+        sinkD = libm; \
+    double t2 = now (); \
+    printf ("%-8s %6.2f ns   libm %6.2f ns\n", name, \
+            (t1 - t0) * 1e9 / calls, (t2 - t1) * 1e9 / calls); \
+} while (0)
+
+int main (int argc, char **argv)
+{
+    long calls = 10000000;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': calls = atol (optarg); break;
+            default:
+                fprintf (stderr, "usage: %s [-n calls]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    checkTrig ();
+    checkAtan2 ();
+    checkSqrt ();
+    checkGauss ();
+    checkDither ();
+
+    printf ("\n");
+    TIME ("sin", calls, fixSin (i * 40503), sin (i * 40503 * (2 * M_PI / FIX_TURN)));
+    TIME ("atan2", calls, fixAtan2 ((i & 0xFFF) - 2048, (i >> 12 & 0xFFF) - 2048),
+            atan2 ((i & 0xFFF) - 2048, (i >> 12 & 0xFFF) - 2048));
+    TIME ("sqrt", calls, fixSqrt ((i * 2654435761u) & 0xFFFFFFFF),
+            sqrt ((i * 2654435761u) & 0xFFFFFFFF));
+    // Against one Box-Muller deviate
+    TIME ("gauss", calls, fixGauss (i * 40503),
+            sqrt (-2 * log ((i % 65535 + 1) / 65536.0)) * cos (i * 0.61685));
+
+    printf ("\n%s\n", fail ? "FAIL" : "pass");
+    return fail;
+}
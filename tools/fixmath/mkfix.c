@@ -0,0 +1,104 @@
+/*
+ * mkfix.c
+ *
+ * Generates the fixed point tables in fixmath.h as C source for the
+ * firmware. Run by src/Makefile on the build machine:
+ *
+ *   mkfix > ../../src/fixtables.c
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "fixmath.h"
+
+/* The inverse of the normal distribution, by bisection on erfc() */
+static double inverseNormal (double p)
+{
+    double lo = -40, hi = 40;
+    for (int i = 0; i < 200; i++)
+    {
+        double mid = (lo + hi) / 2;
+        if (0.5 * erfc (-mid / M_SQRT2) < p)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+/* Prints n values, 12 to a line */
+static void printTable (const long *v, int n)
+{
+    for (int i = 0; i < n; i++)
+        printf ("%s%s%ld", i ? "," : "", i % 12 ? " " : "\n    ", v[i]);
+    printf ("\n};\n\n");
+}
+
+int main (void)
+{
+    long v[SIN_ENTRIES + GAUSS_ENTRIES + SQRT_ENTRIES];
+
+    printf ("/*\n * fixtables.c\n *\n");
+    printf (" * Fixed point tables, see fixmath.h.\n");
+    printf (" * Generated by tools/fixmath/mkfix from src/Makefile, do not edit.\n */\n\n");
+    printf ("#include \"fixmath.h\"\n\n");
+
+    for (int i = 0; i <= SIN_ENTRIES; i++)
+    {
+        v[i] = lround (FIX_ONE * sin (2 * M_PI * i / SIN_ENTRIES));
+        if (v[i] > FIX_ONE - 1)
+            v[i] = FIX_ONE - 1;
+    }
+    printf ("const int16 sinTable[SIN_ENTRIES + 1] = {");
+    printTable (v, SIN_ENTRIES + 1);
+
+    for (int i = 0; i < CORDIC_STEPS; i++)
+        v[i] = lround (atan (ldexp (1, -i)) / (2 * M_PI) * FIX_TURN * (1 << CORDIC_SHIFT));
+    printf ("const uint32 cordicAngles[CORDIC_STEPS] = {");
+    printTable (v, CORDIC_STEPS);
+
+    for (int i = 0; i < SQRT_ENTRIES; i++)
+        v[i] = lround (sqrt (64 + i) * 2048);
+    printf ("const uint16 sqrtTable[SQRT_ENTRIES] = {");
+    printTable (v, SQRT_ENTRIES);
+
+    for (int i = 0; i <= GAUSS_ENTRIES; i++)
+    {
+        double x = i == 0 ? -GAUSS_LIMIT : i == GAUSS_ENTRIES ? GAUSS_LIMIT :
+                inverseNormal ((double)i / GAUSS_ENTRIES);
+        v[i] = lround (x * FIX_GAUSS_ONE);
+    }
+    printf ("const int16 gaussTable[GAUSS_ENTRIES + 1] = {");
+    printTable (v, GAUSS_ENTRIES + 1);
+
+    // Bayer ordered dither: each matrix doubles to [4M, 4M+2; 4M+3, 4M+1]
+    int bayer[DITHER_SIZE][DITHER_SIZE] = { { 0 } };
+    for (int size = 1; size < DITHER_SIZE; size *= 2)
+    {
+        for (int y = size - 1; y >= 0; y--)
+        {
+            for (int x = size - 1; x >= 0; x--)
+            {
+                int m = 4 * bayer[y][x];
+                bayer[y][x] = m;
+                bayer[y][x + size] = m + 2;
+                bayer[y + size][x] = m + 3;
+                bayer[y + size][x + size] = m + 1;
+            }
+        }
+    }
+    // Thresholds at the middle of each of the DITHER_SIZE^2 steps in a shade
+    int step = (FIX_TURN >> 5) / (DITHER_SIZE * DITHER_SIZE);
+    printf ("const uint16 ditherTable[DITHER_SIZE][DITHER_SIZE] = {\n");
+    for (int y = 0; y < DITHER_SIZE; y++)
+    {
+        printf ("    {");
+        for (int x = 0; x < DITHER_SIZE; x++)
+            printf ("%s%d", x ? ", " : " ", bayer[y][x] * step + step / 2);
+        printf (" }%s\n", y < DITHER_SIZE - 1 ? "," : "");
+    }
+    printf ("};\n");
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * curve.c
+ *
+ * Gray level calibration curves for FORMAT_CALIBRATION
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include "curve.h"
+
+int readCurve (const char *name, uint8 *curve)
+{
+    FILE *f = fopen (name, "r");
+    if (f == NULL)
+    {
+        perror (name);
+        return FALSE;
+    }
+
+    int level, gray;
+    for (level = 0; level < GRAY_LEVELS && fscanf (f, "%d", &gray) == 1; level++)
+    {
+        if (gray < 0 || gray >= GRAY_LEVELS)
+            break;
+        curve[level] = gray;
+    }
+    fclose (f);
+    if (level < GRAY_LEVELS)
+    {
+        fprintf (stderr, "%s: level %d is not a gray code 0-%d\n", name, level, GRAY_LEVELS - 1);
+        return FALSE;
+    }
+    return TRUE;
+}
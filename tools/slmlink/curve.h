@@ -0,0 +1,21 @@
+/*
+ * curve.h
+ *
+ * Gray level calibration curves for FORMAT_CALIBRATION (see link.h)
+ *
+ * John Howe 2010
+ */
+
+#ifndef CURVE_H
+#define CURVE_H
+
+#include "link.h"
+
+/* Reads a curve from a text file of GRAY_LEVELS numbers, the gray code
+ * (0-31) to send for each logical level 0-31 in turn. Returns FALSE and
+ * reports why if the file is not a curve. Gray PWM tables (lcd.h) have
+ * the same shape, 2*GRAY_PARAMS widths of 0-31, and are read the same
+ * way. */
+int readCurve (const char *name, uint8 *curve);
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * drawlist.c
+ *
+ * PC side builder for FORMAT_LIST payloads
+ *
+ * John Howe 2010
+ */
+
+#include <string.h>
+#include "drawlist.h"
+
+#define SCROLL_BLOCKS   (LCD_HEIGHT/4) // lcd.h, which needs the AT91 headers
+
+void startDrawList (drawList_t *list, const uint8 *shown)
+{
+    list->length = 0;
+    if (shown)
+        memcpy (list->frame, shown, FRAME_BYTES);
+    else
+        memset (list->frame, 0, FRAME_BYTES);
+}
+
+/* Appends an opcode and its parameters if they fit after extra more bytes */
+static int append (drawList_t *list, unsigned extra, uint8 opcode, const int *params, int count)
+{
+    if (list->length + 1 + count + extra > LIST_MAX)
+        return 0;
+    list->data[list->length++] = opcode;
+    for (int i = 0; i < count; i++)
+        list->data[list->length++] = params[i];
+    return 1;
+}
+
+static int validRect (int c0, int r0, int c1, int r1)
+{
+    return c0 >= 0 && r0 >= 0 && c0 <= c1 && r0 <= r1 &&
+        c1 < LCD_WIDTH/3 && r1 < LCD_HEIGHT;
+}
+
+/* As rampShade() in displist.c, which the firmware must agree with */
+static int rampShade (int s0, int s1, int i, int n)
+{
+    if (n == 0)
+        return s0;
+    if (s1 >= s0)
+        return s0 + ((s1 - s0) * i + n/2) / n;
+    return s0 - ((s0 - s1) * i + n/2) / n;
+}
+
+static void drawPixels (drawList_t *list, int x0, int x1, int y, int shade)
+{
+    memset (list->frame + y*LCD_WIDTH + x0, shade << 3, x1 - x0 + 1);
+}
+
+int listFill (drawList_t *list, int c0, int r0, int c1, int r1, int shade)
+{
+    int params[] = { c0, r0, c1, r1, shade & 0x1F };
+    if (!validRect (c0, r0, c1, r1) || !append (list, 0, LIST_FILL, params, 5))
+        return 0;
+    for (int y = r0; y <= r1; y++)
+        drawPixels (list, 3*c0, 3*c1 + 2, y, shade & 0x1F);
+    return 1;
+}
+
+int listHRamp (drawList_t *list, int c0, int r0, int c1, int r1, int s0, int s1)
+{
+    int params[] = { c0, r0, c1, r1, s0 & 0x1F, s1 & 0x1F };
+    if (!validRect (c0, r0, c1, r1) || !append (list, 0, LIST_HRAMP, params, 6))
+        return 0;
+    for (int y = r0; y <= r1; y++)
+        for (int c = c0; c <= c1; c++)
+            drawPixels (list, 3*c, 3*c + 2, y, rampShade (s0 & 0x1F, s1 & 0x1F, c - c0, c1 - c0));
+    return 1;
+}
+
+int listVRamp (drawList_t *list, int c0, int r0, int c1, int r1, int s0, int s1)
+{
+    int params[] = { c0, r0, c1, r1, s0 & 0x1F, s1 & 0x1F };
+    if (!validRect (c0, r0, c1, r1) || !append (list, 0, LIST_VRAMP, params, 6))
+        return 0;
+    for (int y = r0; y <= r1; y++)
+        drawPixels (list, 3*c0, 3*c1 + 2, y, rampShade (s0 & 0x1F, s1 & 0x1F, y - r0, r1 - r0));
+    return 1;
+}
+
+int listRepeat (drawList_t *list, int c0, int r0, int c1, int r1)
+{
+    int params[] = { c0, r0, c1, r1 };
+    if (!validRect (c0, r0, c1, r1) || !append (list, 0, LIST_REPEAT, params, 4))
+        return 0;
+    for (int y = r0 + 1; y <= r1; y++)
+        memcpy (list->frame + y*LCD_WIDTH + 3*c0, list->frame + r0*LCD_WIDTH + 3*c0, 3*(c1 - c0 + 1));
+    return 1;
+}
+
+int listBlit (drawList_t *list, int c0, int r0, int c1, int r1, const uint8 *shades)
+{
+    int params[] = { c0, r0, c1, r1 };
+    if (!validRect (c0, r0, c1, r1))
+        return 0;
+    unsigned width = 3*(c1 - c0 + 1), pixels = width * (r1 - r0 + 1);
+    if (!append (list, pixels, LIST_BLIT, params, 4))
+        return 0;
+    for (unsigned i = 0; i < pixels; i++)
+    {
+        list->data[list->length++] = shades[i] & 0x1F;
+        list->frame[(r0 + i/width)*LCD_WIDTH + 3*c0 + i%width] = (shades[i] & 0x1F) << 3;
+    }
+    return 1;
+}
+
+int listScroll (drawList_t *list, int block)
+{
+    int params[] = { block };
+    if (block < 0 || block >= SCROLL_BLOCKS)
+        return 0;
+    return append (list, 0, LIST_SCROLL, params, 1);
+}
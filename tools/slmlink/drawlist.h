@@ -0,0 +1,42 @@
+/*
+ * drawlist.h
+ *
+ * PC side builder for FORMAT_LIST payloads (displist.h), with a reference
+ * renderer giving the frame each list leaves in the framebuffer
+ *
+ * John Howe 2010
+ */
+
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include "link.h"
+#include "displist.h"
+
+/* Largest payload the 16 bit length allows */
+#define LIST_MAX        0xFFFF
+
+typedef struct {
+    uint8 data[LIST_MAX];       // the payload
+    unsigned length;
+    uint8 frame[FRAME_BYTES];   // RAMWR bytes (shade<<3) once it has run
+} drawList_t;
+
+/* Start an empty list over shown, the frame on display before it (NULL
+ * for a black panel) */
+void startDrawList (drawList_t *list, const uint8 *shown);
+
+/* Append a command, also drawing it into list->frame. Arguments are as in
+ * displist.h. Each returns 0 if the command is out of range or the list is
+ * full, in which case nothing is added. */
+int listFill (drawList_t *list, int c0, int r0, int c1, int r1, int shade);
+int listHRamp (drawList_t *list, int c0, int r0, int c1, int r1, int s0, int s1);
+int listVRamp (drawList_t *list, int c0, int r0, int c1, int r1, int s0, int s1);
+int listRepeat (drawList_t *list, int c0, int r0, int c1, int r1);
+int listBlit (drawList_t *list, int c0, int r0, int c1, int r1, const uint8 *shades);
+
+/* Scrolling moves the display, not display RAM, so list->frame (which is
+ * what slmhost -f writes) is unchanged */
+int listScroll (drawList_t *list, int block);
+
+#endif
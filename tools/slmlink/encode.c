@@ -0,0 +1,69 @@
+/*
+ * encode.c
+ *
+ * PC side encoder for the compressed link formats in codec.h
+ *
+ * John Howe 2010
+ */
+
+#include "encode.h"
+
+/* Write values as literal tokens of up to CODEC_MAX values */
+static unsigned literals (const uint8 *v, unsigned n, uint8 *out)
+{
+    unsigned length = 0;
+    while (n)
+    {
+        unsigned k = n < CODEC_MAX ? n : CODEC_MAX;
+        out[length++] = k - 1;
+        for (unsigned j = 0; j < k; j++)
+            out[length++] = *v++;
+        n -= k;
+    }
+    return length;
+}
+
+/* Encode one row of shades. Runs of three or more become run tokens,
+ * everything else is gathered into literals. */
+static unsigned encodeRow (const uint8 *v, unsigned n, uint8 *out)
+{
+    unsigned length = 0;
+    unsigned literal = 0; // start of pending literal values
+    unsigned i = 0;
+
+    while (i < n)
+    {
+        unsigned run = 1;
+        while (i + run < n && v[i + run] == v[i] && run < CODEC_MAX)
+            run++;
+
+        if (run >= 3)
+        {
+            length += literals (v + literal, i - literal, out + length);
+            out[length++] = CODEC_RUN | (run - 1);
+            out[length++] = v[i];
+            literal = i + run;
+        }
+        i += run;
+    }
+    return length + literals (v + literal, n - literal, out + length);
+}
+
+unsigned encodeFrame (uint8 format, const uint8 *frame, const uint8 *previous, uint8 *out)
+{
+    uint8 row[LCD_WIDTH];
+    unsigned length = 0;
+
+    for (int y = 0; y < LCD_HEIGHT; y++)
+    {
+        for (int x = 0; x < LCD_WIDTH; x++)
+        {
+            uint8 shade = frame[y*LCD_WIDTH + x] >> 3;
+            if (format == FORMAT_DELTA)
+                shade ^= previous[y*LCD_WIDTH + x] >> 3;
+            row[x] = shade;
+        }
+        length += encodeRow (row, LCD_WIDTH, out + length);
+    }
+    return length;
+}
@@ -0,0 +1,22 @@
+/*
+ * encode.h
+ *
+ * PC side encoder for the compressed link formats in codec.h
+ *
+ * John Howe 2010
+ */
+
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include "codec.h"
+
+/* Worst case payload: every row all literals */
+#define ENCODE_MAX      (LCD_HEIGHT * (LCD_WIDTH + (LCD_WIDTH + CODEC_MAX - 1) / CODEC_MAX))
+
+/* Encode a frame of RAMWR bytes (shade<<3) into out, which must hold
+ * ENCODE_MAX bytes. FORMAT_DELTA encodes the XOR with previous, which must
+ * be the frame last shown. Returns the payload length. */
+unsigned encodeFrame (uint8 format, const uint8 *frame, const uint8 *previous, uint8 *out);
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * slmlist.c
+ *
+ * Sends procedural test frames to the SLM as display lists (FORMAT_LIST,
+ * see displist.h), paced at a fixed frame rate.
+ *
+ *   slmlist [-r rate] [-n frames] [-i shown] [-e expected] [-o output]
+ *
+ *   -r rate      frames per second, 0 to send as fast as possible (50)
+ *   -n frames    number of frames to send (100)
+ *   -i shown     the frame on display beforehand, LCD_WIDTH*LCD_HEIGHT
+ *                bytes in RAMWR order (default black)
+ *   -e expected  write the frame the last list should leave on display, to
+ *                compare with slmhost -f
+ *   -o output    serial device (e.g. /dev/ttyACM0) or file, default stdout
+ *
+ * Each frame is a vertical ramp behind a horizontal ramp band, a moving
+ * block, a blitted sprite and a pattern row repeated down the panel, all
+ * of which change every frame. Prints the bytes sent per frame against a
+ * FORMAT_RAW frame.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include "drawlist.h"
+
+static drawList_t list;
+static uint8 shown[FRAME_BYTES];
+
+#define SPRITE_COLS     4
+#define SPRITE_ROWS     12
+
+static void writeAll (int fd, const uint8 *data, size_t count)
+{
+    while (count)
+    {
+        ssize_t n = write (fd, data, count);
+        if (n < 0)
+        {
+            perror ("write");
+            exit (1);
+        }
+        data += n;
+        count -= n;
+    }
+}
+
+static void testList (unsigned n)
+{
+    uint8 sprite[SPRITE_ROWS][3*SPRITE_COLS];
+    for (int y = 0; y < SPRITE_ROWS; y++)
+        for (int x = 0; x < 3*SPRITE_COLS; x++)
+            sprite[y][x] = ((x ^ y) + n) & 31;
+
+    startDrawList (&list, shown);
+    listVRamp (&list, 0, 0, LCD_WIDTH/3-1, LCD_HEIGHT-1, n & 31, 31 - (n & 31));
+    listHRamp (&list, 0, 60, LCD_WIDTH/3-1, 79, 0, 31);
+    int c = n % (LCD_WIDTH/3 - 10);
+    listFill (&list, c, 20, c + 9, 49, 31 - (n & 31));
+    listBlit (&list, 70 - c, 90, 70 - c + SPRITE_COLS-1, 90 + SPRITE_ROWS-1, &sprite[0][0]);
+
+    // One row of stripes drawn, then copied down
+    listFill (&list, 0, 120, LCD_WIDTH/3-1, 120, 0);
+    for (int s = n % 8; s < LCD_WIDTH/3; s += 8)
+        listFill (&list, s, 120, s + 3 < LCD_WIDTH/3 ? s + 3 : LCD_WIDTH/3-1, 120, 24);
+    listRepeat (&list, 0, 120, LCD_WIDTH/3-1, 149);
+    listScroll (&list, 0);
+}
+
+int main (int argc, char **argv)
+{
+    double rate = 50;
+    unsigned long count = 100;
+    const char *output = NULL, *initial = NULL, *expected = NULL;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "r:n:i:e:o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': rate = atof (optarg); break;
+            case 'n': count = atol (optarg); break;
+            case 'i': initial = optarg; break;
+            case 'e': expected = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf (stderr, "usage: %s [-r rate] [-n frames] [-i shown] [-e expected] [-o output]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (initial)
+    {
+        FILE *f = fopen (initial, "rb");
+        if (f == NULL || fread (shown, 1, FRAME_BYTES, f) != FRAME_BYTES)
+        {
+            fprintf (stderr, "%s: no whole frame\n", initial);
+            return 1;
+        }
+        fclose (f);
+    }
+
+    int fd = STDOUT_FILENO;
+    if (output && (fd = open (output, O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644)) < 0)
+    {
+        perror (output);
+        return 1;
+    }
+    if (isatty (fd))
+    {
+        struct termios tio;
+        tcgetattr (fd, &tio);
+        cfmakeraw (&tio);
+        tcsetattr (fd, TCSANOW, &tio);
+    }
+
+    struct timespec next;
+    clock_gettime (CLOCK_MONOTONIC, &next);
+    long period = rate > 0 ? (long)(1e9 / rate) : 0;
+    unsigned long long bytes = 0;
+
+    for (unsigned long sent = 0; sent < count; sent++)
+    {
+        testList (sent);
+        if (period)
+        {
+            clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            next.tv_nsec += period;
+            while (next.tv_nsec >= 1000000000)
+            {
+                next.tv_nsec -= 1000000000;
+                next.tv_sec++;
+            }
+        }
+
+        uint8 header[LINK_HEADER] = {
+            LINK_SYNC0, LINK_SYNC1, FORMAT_LIST, sent, list.length & 0xFF, list.length >> 8
+        };
+        writeAll (fd, header, sizeof(header));
+        writeAll (fd, list.data, list.length);
+        memcpy (shown, list.frame, FRAME_BYTES);
+        bytes += LINK_HEADER + list.length;
+    }
+
+    if (expected)
+    {
+        FILE *f = fopen (expected, "wb");
+        if (f == NULL || fwrite (shown, 1, FRAME_BYTES, f) != FRAME_BYTES)
+        {
+            perror (expected);
+            return 1;
+        }
+        fclose (f);
+    }
+
+    fprintf (stderr, "sent %lu frames, %.1f bytes per frame against %u raw\n",
+            count, count ? (double)bytes / count : 0.0, LINK_HEADER + FRAME_BYTES);
+    return 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * slmpack.c
+ *
+ * Packs frame sequences into a sequence store image (seqstore.h) for the
+ * SLM to play without a PC attached.
+ *
+ *   slmpack [-r rate] [-c format] [-k curve] [-o output] [-l] file[@rate] ...
+ *
+ *   -r rate    frames per second for files without their own @rate (50)
+ *   -c format  raw, rle, or auto to store whichever of raw, rle and delta
+ *              is smallest for each frame (auto)
+ *   -k curve   start every sequence by loading the calibration curve in
+ *              the text file curve (see curve.h)
+ *   -o output  image file, or with -l the serial device; default stdout
+ *   -l         write the image as FORMAT_PAGE link frames, to program the
+ *              store over the link (e.g. -o /dev/ttyACM0), rather than as
+ *              an image to link into the firmware (make SEQSTORE=...)
+ *   file       one sequence: frames of LCD_WIDTH*LCD_HEIGHT bytes in RAMWR
+ *              order, as for slmsend
+ *
+ * Prints the size of each sequence and how full the store is.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include "link.h"
+#include "seqstore.h"
+#include "encode.h"
+#include "curve.h"
+
+static uint8 store[STORE_SIZE];
+static unsigned used; // bytes of the store filled
+static uint8 frame[FRAME_BYTES];
+static uint8 previous[FRAME_BYTES];
+static uint8 encoded[2][ENCODE_MAX];
+static uint8 curve[GRAY_LEVELS];
+static int calibrate = FALSE; // start each sequence with curve
+
+#define AUTO    FORMATS
+static const char *formats[AUTO + 1] = {
+    [FORMAT_RAW] = "raw", [FORMAT_RLE] = "rle", [FORMAT_DELTA] = "delta", [AUTO] = "auto"
+};
+
+static void put (unsigned at, unsigned long value, int bytes)
+{
+    while (bytes--)
+    {
+        store[at++] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+/* Appends bytes to the store, returns FALSE if it is full */
+static int append (const uint8 *data, unsigned count)
+{
+    if (count > STORE_SIZE - used)
+        return FALSE;
+    memcpy (store + used, data, count);
+    used += count;
+    return TRUE;
+}
+
+/* TC0 ticks at STORE_MIN_RATE or faster, slower rates hold frames */
+static void tickRate (double rate, uint8 *ticks, uint8 *hold)
+{
+    int h = 1;
+    while (rate * h < STORE_MIN_RATE - 0.5)
+        h++;
+    *ticks = (uint8)(rate * h + 0.5);
+    *hold = h;
+}
+
+static int packSequence (int index, const char *name, double rate, int format)
+{
+    FILE *input = fopen (name, "rb");
+    if (input == NULL)
+    {
+        perror (name);
+        return FALSE;
+    }
+
+    unsigned offset = (used + 3) & ~3U;
+    memset (store + used, 0xFF, offset - used);
+    used = offset;
+
+    uint8 sequence = 0;
+    if (calibrate)
+    {
+        uint8 header[LINK_HEADER] = {
+            LINK_SYNC0, LINK_SYNC1, FORMAT_CALIBRATION, sequence++, GRAY_LEVELS, 0
+        };
+        if (!append (header, sizeof(header)) || !append (curve, GRAY_LEVELS))
+        {
+            fprintf (stderr, "%s: store full\n", name);
+            fclose (input);
+            return FALSE;
+        }
+    }
+
+    unsigned long frames = 0;
+    while (fread (frame, 1, FRAME_BYTES, input) == FRAME_BYTES)
+    {
+        // The first frame has no reference for a delta
+        uint8 f = format;
+        const uint8 *payload = frame;
+        unsigned length = FRAME_BYTES;
+        if (f != FORMAT_RAW)
+        {
+            unsigned rle = encodeFrame (FORMAT_RLE, frame, previous, encoded[0]);
+            unsigned delta = frames ? encodeFrame (FORMAT_DELTA, frame, previous, encoded[1]) : ENCODE_MAX;
+            if (f == FORMAT_RLE || rle < length)
+            {
+                f = FORMAT_RLE;
+                length = rle;
+                payload = encoded[0];
+            }
+            if (format == AUTO && delta < length)
+            {
+                f = FORMAT_DELTA;
+                length = delta;
+                payload = encoded[1];
+            }
+            if (f == AUTO)
+                f = FORMAT_RAW;
+        }
+
+        uint8 header[LINK_HEADER] = {
+            LINK_SYNC0, LINK_SYNC1, f, sequence++, length & 0xFF, length >> 8
+        };
+        if (!append (header, sizeof(header)) || !append (payload, length))
+        {
+            fprintf (stderr, "%s: store full after %lu frames\n", name, frames);
+            fclose (input);
+            return FALSE;
+        }
+        memcpy (previous, frame, FRAME_BYTES);
+        frames++;
+    }
+    fclose (input);
+    if (frames == 0 || frames > 0xFFFF)
+    {
+        fprintf (stderr, "%s: %lu frames\n", name, frames);
+        return FALSE;
+    }
+
+    uint8 ticks, hold;
+    tickRate (rate, &ticks, &hold);
+
+    unsigned entry = 8 + index*STORE_ENTRY;
+    put (entry, offset, 4);
+    put (entry + 4, used - offset, 4);
+    put (entry + 8, frames, 2);
+    store[entry + 10] = ticks;
+    store[entry + 11] = hold;
+
+    fprintf (stderr, "%d: %s, %lu frames at %.2f/s, %u bytes, ratio %.2f:1\n",
+            index, name, frames, (double)ticks / hold, used - offset,
+            (double)frames * (LINK_HEADER + FRAME_BYTES) / (used - offset));
+    return TRUE;
+}
+
+static void writeAll (int fd, const uint8 *data, size_t count)
+{
+    while (count)
+    {
+        ssize_t n = write (fd, data, count);
+        if (n < 0)
+        {
+            perror ("write");
+            exit (1);
+        }
+        data += n;
+        count -= n;
+    }
+}
+
+/* Sends each page of the image as a FORMAT_PAGE link frame */
+static void writePages (int fd, unsigned pages)
+{
+    for (unsigned page = 0; page < pages; page++)
+    {
+        unsigned length = 2 + STORE_PAGE;
+        uint8 header[LINK_HEADER + 2] = {
+            LINK_SYNC0, LINK_SYNC1, FORMAT_PAGE, page & 0xFF,
+            length & 0xFF, length >> 8, page & 0xFF, page >> 8
+        };
+        writeAll (fd, header, sizeof(header));
+        writeAll (fd, store + page*STORE_PAGE, STORE_PAGE);
+    }
+}
+
+int main (int argc, char **argv)
+{
+    double rate = 50;
+    int format = AUTO;
+    const char *output = NULL;
+    int pages = FALSE;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "r:c:k:o:l")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': rate = atof (optarg); break;
+            case 'o': output = optarg; break;
+            case 'l': pages = TRUE; break;
+            case 'k':
+                if (!readCurve (optarg, curve))
+                    return 1;
+                calibrate = TRUE;
+                break;
+            case 'c':
+                for (format = 0; format <= AUTO; format++)
+                    if (formats[format] && strcmp (optarg, formats[format]) == 0)
+                        break;
+                if (format <= AUTO && format != FORMAT_DELTA)
+                    break;
+                // fall through
+            default:
+                fprintf (stderr, "usage: %s [-r rate] [-c raw|rle|auto] [-k curve] [-o output] [-l] file[@rate] ...\n", argv[0]);
+                return 2;
+        }
+    }
+    int count = argc - optind;
+    if (count < 1 || count > STORE_SEQUENCES)
+    {
+        fprintf (stderr, "%s: 1 to %d sequences\n", argv[0], STORE_SEQUENCES);
+        return 2;
+    }
+
+    memset (store, 0xFF, STORE_HEADER);
+    put (0, STORE_MAGIC, 4);
+    put (4, count, 4);
+    used = STORE_HEADER;
+    for (int i = 0; i < count; i++)
+    {
+        char name[1024];
+        double r = rate;
+        snprintf (name, sizeof(name), "%s", argv[optind + i]);
+        char *at = strrchr (name, '@');
+        if (at)
+        {
+            *at = '\0';
+            r = atof (at + 1);
+        }
+        if (r <= 0 || r > 255)
+        {
+            fprintf (stderr, "%s: rate %g out of range\n", name, r);
+            return 2;
+        }
+        if (!packSequence (i, name, r, format))
+            return 1;
+    }
+
+    // Whole pages, padded as erased flash
+    unsigned size = (used + STORE_PAGE - 1) / STORE_PAGE * STORE_PAGE;
+    memset (store + used, 0xFF, size - used);
+    fprintf (stderr, "store %u of %u bytes (%u pages), %.1f%% full\n",
+            size, STORE_SIZE, size / STORE_PAGE, 100.0 * size / STORE_SIZE);
+
+    int fd = STDOUT_FILENO;
+    if (output && (fd = open (output, O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644)) < 0)
+    {
+        perror (output);
+        return 1;
+    }
+    if (isatty (fd))
+    {
+        struct termios tio;
+        tcgetattr (fd, &tio);
+        cfmakeraw (&tio);
+        tcsetattr (fd, TCSANOW, &tio);
+    }
+    if (pages)
+        writePages (fd, size / STORE_PAGE);
+    else
+        writeAll (fd, store, size);
+    close (fd);
+    return 0;
+}
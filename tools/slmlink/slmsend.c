@@ -0,0 +1,257 @@
+/*
+ * slmsend.c
+ *
+ * Sends frames to the SLM over the link protocol in link.h, paced at a
+ * fixed frame rate.
+ *
+ *   slmsend [-r rate] [-n frames] [-c format] [-k curve] [-g slot[:pwm]]
+ *           [-o output] [file]
+ *
+ *   -r rate    frames per second, 0 to send as fast as possible (50)
+ *   -n frames  number of frames to send, 0 for ever (default: one pass
+ *              through file, or 500 test frames)
+ *   -c format  raw, rle, delta, or auto to send whichever of the three is
+ *              smallest for each frame (raw)
+ *   -k curve   first load the calibration curve in the text file curve
+ *              (see curve.h)
+ *   -g slot[:pwm]
+ *              first select gray PWM slot (0-3), storing the table in the
+ *              text file pwm in it first if given: GRAY_PARAMS widths for
+ *              GRAY1 then GRAY_PARAMS for GRAY2, read like a curve
+ *   -o output  serial device (e.g. /dev/ttyACM0) or file, default stdout
+ *   file       frames of LCD_WIDTH*LCD_HEIGHT bytes in RAMWR order; if
+ *              omitted a moving gradient is sent
+ *
+ * Prints the frame rate achieved, the number of frames sent late and the
+ * compression ratio.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include "link.h"
+#include "encode.h"
+#include "curve.h"
+
+static uint8 frame[FRAME_BYTES];
+static uint8 previous[FRAME_BYTES]; // frame last sent
+static uint8 encoded[2][ENCODE_MAX];
+
+#define AUTO    FORMATS
+static const char *formats[AUTO + 1] = {
+    [FORMAT_RAW] = "raw", [FORMAT_RLE] = "rle", [FORMAT_DELTA] = "delta", [AUTO] = "auto"
+};
+
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void writeAll (int fd, const uint8 *data, size_t count)
+{
+    while (count)
+    {
+        ssize_t n = write (fd, data, count);
+        if (n < 0)
+        {
+            perror ("write");
+            exit (1);
+        }
+        data += n;
+        count -= n;
+    }
+}
+
+/* Diagonal gradient moving one shade per frame */
+static void testFrame (unsigned n)
+{
+    for (int y = 0; y < LCD_HEIGHT; y++)
+        for (int x = 0; x < LCD_WIDTH; x++)
+            frame[y*LCD_WIDTH + x] = (((x + y) / 4 + n) & 31) << 3;
+}
+
+static void sendFrame (int fd, uint8 format, uint8 sequence, const uint8 *payload, uint16 length)
+{
+    uint8 header[LINK_HEADER] = {
+        LINK_SYNC0, LINK_SYNC1, format, sequence, length & 0xFF, length >> 8
+    };
+    writeAll (fd, header, sizeof(header));
+    writeAll (fd, payload, length);
+}
+
+int main (int argc, char **argv)
+{
+    double rate = 50;
+    long count = -1;
+    const char *output = NULL;
+    int format = FORMAT_RAW;
+    uint8 curve[GRAY_LEVELS];
+    int calibrate = FALSE;
+    uint8 gray[1 + 2*GRAY_PARAMS];
+    unsigned grayLength = 0;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "r:n:c:k:g:o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': rate = atof (optarg); break;
+            case 'n': count = atol (optarg); break;
+            case 'o': output = optarg; break;
+            case 'k':
+                if (!readCurve (optarg, curve))
+                    return 1;
+                calibrate = TRUE;
+                break;
+            case 'g':
+            {
+                char *pwm = strchr (optarg, ':');
+                gray[0] = atoi (optarg);
+                grayLength = 1;
+                if (pwm && !readCurve (pwm + 1, gray + 1))
+                    return 1;
+                if (pwm)
+                    grayLength += 2*GRAY_PARAMS;
+                break;
+            }
+            case 'c':
+                for (format = 0; format <= AUTO; format++)
+                    if (formats[format] && strcmp (optarg, formats[format]) == 0)
+                        break;
+                if (format <= AUTO)
+                    break;
+                // fall through
+            default:
+                fprintf (stderr, "usage: %s [-r rate] [-n frames] [-c raw|rle|delta|auto] [-k curve] [-g slot[:pwm]] [-o output] [file]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    FILE *input = NULL;
+    if (optind < argc && (input = fopen (argv[optind], "rb")) == NULL)
+    {
+        perror (argv[optind]);
+        return 1;
+    }
+    int onePass = (count < 0 && input);
+    if (count < 0)
+        count = input ? 0 : 500;
+
+    int fd = STDOUT_FILENO;
+    if (output && (fd = open (output, O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644)) < 0)
+    {
+        perror (output);
+        return 1;
+    }
+    if (isatty (fd))
+    {
+        // The CDC port ignores the baud rate, but the tty must not mangle bytes
+        struct termios tio;
+        tcgetattr (fd, &tio);
+        cfmakeraw (&tio);
+        tcsetattr (fd, TCSANOW, &tio);
+    }
+
+    struct timespec next;
+    clock_gettime (CLOCK_MONOTONIC, &next);
+    long period = rate > 0 ? (long)(1e9 / rate) : 0;
+
+    double start = now ();
+    unsigned long sent = 0, late = 0;
+    unsigned long long bytes = 0;
+    unsigned long used[FORMATS] = { 0 };
+    uint8 sequence = 0;
+
+    if (calibrate)
+        sendFrame (fd, FORMAT_CALIBRATION, sequence++, curve, GRAY_LEVELS);
+    if (grayLength)
+        sendFrame (fd, FORMAT_GRAY, sequence++, gray, grayLength);
+
+    while (count == 0 || sent < (unsigned long)count)
+    {
+        if (input)
+        {
+            if (fread (frame, 1, FRAME_BYTES, input) != FRAME_BYTES)
+            {
+                if (onePass && sent)
+                    break;
+                rewind (input);
+                if (fread (frame, 1, FRAME_BYTES, input) != FRAME_BYTES)
+                {
+                    fprintf (stderr, "%s: no whole frame\n", argv[optind]);
+                    return 1;
+                }
+            }
+        }
+        else
+            testFrame (sent);
+
+        if (period)
+        {
+            struct timespec t;
+            clock_gettime (CLOCK_MONOTONIC, &t);
+            if (t.tv_sec > next.tv_sec || (t.tv_sec == next.tv_sec && t.tv_nsec > next.tv_nsec))
+                late++;
+            else
+                clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            next.tv_nsec += period;
+            while (next.tv_nsec >= 1000000000)
+            {
+                next.tv_nsec -= 1000000000;
+                next.tv_sec++;
+            }
+        }
+
+        // The first frame has no reference for a delta
+        uint8 f = format;
+        const uint8 *payload = frame;
+        unsigned length = FRAME_BYTES;
+        if (f == FORMAT_DELTA && sent == 0)
+            f = FORMAT_RLE;
+        if (f == FORMAT_RLE || f == FORMAT_DELTA)
+        {
+            length = encodeFrame (f, frame, previous, encoded[0]);
+            payload = encoded[0];
+        }
+        else if (f == AUTO)
+        {
+            unsigned rle = encodeFrame (FORMAT_RLE, frame, previous, encoded[0]);
+            unsigned delta = sent ? encodeFrame (FORMAT_DELTA, frame, previous, encoded[1]) : ENCODE_MAX;
+            f = FORMAT_RAW;
+            if (rle < length)
+            {
+                f = FORMAT_RLE;
+                length = rle;
+                payload = encoded[0];
+            }
+            if (delta < length)
+            {
+                f = FORMAT_DELTA;
+                length = delta;
+                payload = encoded[1];
+            }
+        }
+
+        sendFrame (fd, f, sequence++, payload, length);
+        memcpy (previous, frame, FRAME_BYTES);
+        bytes += LINK_HEADER + length;
+        used[f]++;
+        sent++;
+    }
+
+    double elapsed = now () - start;
+    fprintf (stderr, "sent %lu frames in %.3f s, %.1f frames/s, %lu late\n",
+            sent, elapsed, elapsed > 0 ? sent / elapsed : 0.0, late);
+    fprintf (stderr, "%llu bytes, ratio %.2f:1 (raw %lu, rle %lu, delta %lu)\n",
+            bytes, bytes ? (double)sent * (LINK_HEADER + FRAME_BYTES) / bytes : 0.0,
+            used[FORMAT_RAW], used[FORMAT_RLE], used[FORMAT_DELTA]);
+    return 0;
+}
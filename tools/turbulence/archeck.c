@@ -0,0 +1,94 @@
+/*
+ * archeck.c
+ *
+ * Runs the device phase screen generator (turbulence.c with arcoef.c) on
+ * the PC and compares the structure function of its screens, along and
+ * across the rows, with the von Karman structure function it was built for.
+ *
+ *   archeck [-n rows] [-s seed] [-t tolerance]
+ *
+ * Exits non-zero if any separation up to MAX_R is off by more than the
+ * tolerance (0.15, relative).
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include "turbulence.h"
+#include "vonkarman.h"
+
+#define MAX_R       16
+#define PHASE_UNIT  (256 * 32 / (2 * M_PI))
+
+static int32 rows[MAX_R + 1][AR_COLS]; // ring of the last rows
+
+int main (int argc, char **argv)
+{
+    long count = 20000;
+    uint32 seed = 1;
+    double tolerance = 0.15;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "n:s:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = atol (optarg); break;
+            case 's': seed = strtoul (optarg, NULL, 0); break;
+            case 't': tolerance = atof (optarg); break;
+            default:
+                fprintf (stderr, "usage: %s [-n rows] [-s seed] [-t tolerance]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    double along[MAX_R + 1] = { 0 }, across[MAX_R + 1] = { 0 };
+    long nAlong[MAX_R + 1] = { 0 }, nAcross[MAX_R + 1] = { 0 };
+
+    startTurbulence (seed);
+    for (long n = 0; n < count; n++)
+    {
+        int32 *row = rows[n % (MAX_R + 1)];
+        nextTurbulence (row);
+
+        for (int r = 1; r <= MAX_R; r++)
+        {
+            for (int i = 0; i + r < AR_COLS; i++)
+            {
+                double d = row[i + r] - row[i];
+                along[r] += d * d;
+                nAlong[r]++;
+            }
+            if (n >= r)
+            {
+                const int32 *old = rows[(n - r) % (MAX_R + 1)];
+                for (int i = 0; i < AR_COLS; i++)
+                {
+                    double d = row[i] - old[i];
+                    across[r] += d * d;
+                    nAcross[r]++;
+                }
+            }
+        }
+    }
+
+    printf ("r0 %d, L0 %d samples, %ld rows of %d\n\n", arR0, arL0, count, AR_COLS);
+    printf ("   r   von Karman   along    error   across   error   Kolmogorov\n");
+    int fail = 0;
+    for (int r = 1; r <= MAX_R; r++)
+    {
+        double theory = structureFunction (r, arR0, arL0);
+        double a = along[r] / nAlong[r] / (PHASE_UNIT * PHASE_UNIT);
+        double c = across[r] / nAcross[r] / (PHASE_UNIT * PHASE_UNIT);
+        double ea = a / theory - 1, ec = c / theory - 1;
+        printf ("%4d %10.3f %10.3f %+7.1f%% %8.3f %+7.1f%% %10.3f\n", r, theory,
+                a, 100 * ea, c, 100 * ec, kolmogorov (r, arR0));
+        if (fabs (ea) > tolerance || fabs (ec) > tolerance)
+            fail = 1;
+    }
+    printf ("\n%s (tolerance %.0f%%)\n", fail ? "FAIL" : "pass", 100 * tolerance);
+    return fail;
+}
@@ -0,0 +1,217 @@
+/*
+ * mkar.c
+ *
+ * Generates the autoregression coefficients for the on-device phase screen
+ * extrusion in turbulence.h, as C source for the firmware.
+ *
+ *   mkar [-r r0] [-L L0] > arcoef.c
+ *
+ * src/Makefile runs it with the defaults at build time; arcoef.c is not
+ * checked in.
+ *
+ *   -r r0   Fried parameter in phase samples (8)
+ *   -L L0   outer scale in phase samples (200)
+ *
+ * With Z the stencil (the AR_DEPTH previous rows) and X the new row:
+ *
+ *   A = Cxz Czz^-1
+ *   B B' = Cxx - A Czx,  B lower triangular (Cholesky)
+ *
+ * B is scaled for noise of AR_NOISE_STD deviation, and both are stored as
+ * 16 bit integers with the largest shift that fits.
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "turbulence.h"
+#include "vonkarman.h"
+
+#define NX  AR_COLS
+#define NZ  AR_STENCIL
+
+// 1 rad in device phase units (1/256 shade, 32 shades per 2 pi)
+#define PHASE_UNIT  (256 * 32 / (2 * M_PI))
+
+/* Position of stencil element j, in the order turbulence.c keeps them */
+static void stencilPoint (int j, double *x, double *y)
+{
+    *x = j % AR_COLS;
+    *y = 1 + j / AR_COLS;
+}
+
+/* In-place Cholesky factorisation of an n x n matrix, lower triangle.
+ * Returns the jitter added to the diagonal to keep it positive. */
+static double cholesky (double *m, int n)
+{
+    double jitter = 0;
+    for (;;)
+    {
+        double *l = malloc (n * n * sizeof(double));
+        memcpy (l, m, n * n * sizeof(double));
+        for (int i = 0; i < n; i++)
+            l[i*n + i] += jitter;
+        int ok = 1;
+        for (int j = 0; j < n && ok; j++)
+        {
+            double d = l[j*n + j];
+            for (int k = 0; k < j; k++)
+                d -= l[j*n + k] * l[j*n + k];
+            if (d <= 0)
+            {
+                ok = 0;
+                break;
+            }
+            l[j*n + j] = sqrt (d);
+            for (int i = j + 1; i < n; i++)
+            {
+                double s = l[i*n + j];
+                for (int k = 0; k < j; k++)
+                    s -= l[i*n + k] * l[j*n + k];
+                l[i*n + j] = s / l[j*n + j];
+            }
+        }
+        if (ok)
+        {
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++)
+                    m[i*n + j] = j <= i ? l[i*n + j] : 0;
+            free (l);
+            return jitter;
+        }
+        free (l);
+        jitter = jitter ? jitter * 10 : 1e-9 * m[0];
+    }
+}
+
+/* Solve L L' x = b for x, in place */
+static void cholSolve (const double *l, int n, double *b)
+{
+    for (int i = 0; i < n; i++)
+    {
+        for (int k = 0; k < i; k++)
+            b[i] -= l[i*n + k] * b[k];
+        b[i] /= l[i*n + i];
+    }
+    for (int i = n - 1; i >= 0; i--)
+    {
+        for (int k = i + 1; k < n; k++)
+            b[i] -= l[k*n + i] * b[k];
+        b[i] /= l[i*n + i];
+    }
+}
+
+/* Largest shift that keeps round(v * 2^shift) within int16 */
+static int fitShift (double max)
+{
+    int shift = 0;
+    while (shift < 30 && max * ldexp (1, shift + 1) < 32767)
+        shift++;
+    return shift;
+}
+
+int main (int argc, char **argv)
+{
+    double r0 = 8, L0 = 200;
+    int opt;
+
+    while ((opt = getopt (argc, argv, "r:L:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': r0 = atof (optarg); break;
+            case 'L': L0 = atof (optarg); break;
+            default:
+                fprintf (stderr, "usage: %s [-r r0] [-L L0]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    // Covariance as a function of squared distance, tabulated once
+    int maxd2 = (NX - 1) * (NX - 1) + (AR_DEPTH + 1) * (AR_DEPTH + 1) + 1;
+    double *cov = malloc (maxd2 * sizeof(double));
+    for (int d2 = 0; d2 < maxd2; d2++)
+        cov[d2] = phaseCovariance (sqrt (d2), r0, L0) * PHASE_UNIT * PHASE_UNIT;
+
+    double *czz = malloc (NZ * NZ * sizeof(double));
+    double *a = malloc (NX * NZ * sizeof(double));
+    double *cxx = malloc (NX * NX * sizeof(double));
+
+    for (int i = 0; i < NZ; i++)
+        for (int j = 0; j < NZ; j++)
+        {
+            double xi, yi, xj, yj;
+            stencilPoint (i, &xi, &yi);
+            stencilPoint (j, &xj, &yj);
+            czz[i*NZ + j] = cov[(int)((xi-xj)*(xi-xj) + (yi-yj)*(yi-yj))];
+        }
+    double jitterZ = cholesky (czz, NZ);
+
+    // Rows of A: Czz a_i = Czx_i
+    for (int i = 0; i < NX; i++)
+    {
+        double *row = &a[i*NZ];
+        for (int j = 0; j < NZ; j++)
+        {
+            double xj, yj;
+            stencilPoint (j, &xj, &yj);
+            row[j] = cov[(int)((i-xj)*(i-xj) + yj*yj)];
+        }
+        cholSolve (czz, NZ, row);
+    }
+
+    // Cxx - A Czx
+    for (int i = 0; i < NX; i++)
+        for (int k = 0; k < NX; k++)
+        {
+            double s = cov[(i-k)*(i-k)];
+            for (int j = 0; j < NZ; j++)
+            {
+                double xj, yj;
+                stencilPoint (j, &xj, &yj);
+                s -= a[i*NZ + j] * cov[(int)((k-xj)*(k-xj) + yj*yj)];
+            }
+            cxx[i*NX + k] = s;
+        }
+    double jitterX = cholesky (cxx, NX);
+
+    double maxA = 0, maxB = 0;
+    for (int i = 0; i < NX * NZ; i++)
+        maxA = fmax (maxA, fabs (a[i]));
+    for (int i = 0; i < NX * NX; i++)
+        maxB = fmax (maxB, fabs (cxx[i] / AR_NOISE_STD));
+    int shiftA = fitShift (maxA);
+    int shiftB = fitShift (maxB);
+
+    printf ("/*\n * arcoef.c\n *\n");
+    printf (" * Phase screen autoregression coefficients, see turbulence.h.\n");
+    printf (" * Generated by tools/turbulence/mkar -r %g -L %g, do not edit.\n", r0, L0);
+    printf (" * Cholesky jitter %.3g (stencil), %.3g (noise).\n */\n\n", jitterZ, jitterX);
+    printf ("#include \"turbulence.h\"\n\n");
+    printf ("const uint16 arR0 = %d, arL0 = %d;\n", (int)lround (r0), (int)lround (L0));
+    printf ("const uint8 arAShift = %d, arBShift = %d;\n\n", shiftA, shiftB);
+
+    printf ("const int16 arA[AR_COLS][AR_STENCIL] = {\n");
+    for (int i = 0; i < NX; i++)
+    {
+        printf ("    {");
+        for (int j = 0; j < NZ; j++)
+            printf ("%s%s%ld", j ? "," : "", j % 12 ? " " : "\n        ",
+                    lround (ldexp (a[i*NZ + j], shiftA)));
+        printf ("\n    },\n");
+    }
+    printf ("};\n\n");
+
+    printf ("const int16 arB[AR_COLS*(AR_COLS+1)/2] = {");
+    int n = 0;
+    for (int i = 0; i < NX; i++)
+        for (int j = 0; j <= i; j++, n++)
+            printf ("%s%s%ld", n ? "," : "", n % 12 ? " " : "\n    ",
+                    lround (ldexp (cxx[i*NX + j] / AR_NOISE_STD, shiftB)));
+    printf ("\n};\n");
+    return 0;
+}
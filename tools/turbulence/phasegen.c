@@ -0,0 +1,333 @@
+/*
+ * phasegen.c
+ *
+ * Generates sequences of von Karman phase screens for the SLM on the PC,
+ * ready to send with slmsend: one LCD_WIDTH x LCD_HEIGHT frame of RAMWR
+ * bytes (shade<<3) per screen, the phase wrapped every 2 pi onto the 32
+ * shades.
+ *
+ *   phasegen [-n frames] [-r r0] [-L L0] [-s seed] [-j threads] [-c] [output]
+ *
+ *   -n frames   number of screens (500)
+ *   -r r0       Fried parameter in pixels (8)
+ *   -L L0       outer scale in pixels (200)
+ *   -s seed     frame n is the same for the same seed, whatever -j is (1)
+ *   -j threads  worker threads (one per core)
+ *   -c          also print the structure function of the screens against
+ *               von Karman, along the rows up to MAX_R pixels
+ *   output      file, default stdout
+ *
+ * Screens are made by the FFT method on an N x N grid, with three levels
+ * of subharmonics (Lane et al. 1992) for the low frequencies the grid
+ * misses. One complex FFT gives two independent screens, its real and
+ * imaginary parts. Workers take pairs of frames from a shared counter and
+ * leave them in a ring of slots, which the main thread writes out in
+ * order, so memory does not grow with the length of the sequence.
+ *
+ * Prints the frame rate achieved. To play an hour at 50 Hz:
+ *
+ *   phasegen -n 180000 | slmsend -c auto -o /dev/ttyACM0 /dev/stdin
+ *
+ * John Howe 2010
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "link.h"
+#include "vonkarman.h"
+
+#define N           256     // FFT grid, at least LCD_WIDTH
+#define SUBHARMONICS 3
+#define MAX_R       16
+#define SLOTS_PER_THREAD 4
+
+typedef struct {
+    long pair;              // frames 2*pair and 2*pair+1, -1 when free
+    int ready;
+    uint8 frame[2][FRAME_BYTES];
+    double sf[MAX_R + 1];   // structure function sums, for -c
+    long sfCount;
+} slot_t;
+
+static double r0 = 8, L0 = 200;
+static uint64_t seed = 1;
+static long frames = 500;
+static int check = 0;
+
+static double *amplitude;   // sqrt(PSD) * df for every FFT bin
+static slot_t *slots;
+static int nSlots;
+static long nextPair;       // next pair to generate
+static long written;        // pairs written out
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t freed = PTHREAD_COND_INITIALIZER;
+
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* splitmix64, seeded per pair so the output does not depend on threads */
+static uint64_t nextRandom (uint64_t *s)
+{
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Complex gaussian with unit variance in each part (Box-Muller) */
+static double complex gaussian (uint64_t *s)
+{
+    double u = (nextRandom (s) >> 11) * 0x1.0p-53;
+    double v = (nextRandom (s) >> 11) * 0x1.0p-53;
+    double r = sqrt (-2 * log (1 - u));
+    return r * cos (2 * M_PI * v) + I * r * sin (2 * M_PI * v);
+}
+
+static double complex twiddle[N/2]; // exp(2 pi i k / N)
+
+/* In-place radix 2 FFT of N points spaced stride apart */
+static void fft (double complex *x, int stride)
+{
+    const int n = N;
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            double complex t = x[i*stride];
+            x[i*stride] = x[j*stride];
+            x[j*stride] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        int step = n / len;
+        for (int i = 0; i < n; i += len)
+            for (int k = 0; k < len / 2; k++)
+            {
+                double complex a = x[(i + k)*stride];
+                double complex b = x[(i + k + len/2)*stride] * twiddle[k*step];
+                x[(i + k)*stride] = a + b;
+                x[(i + k + len/2)*stride] = a - b;
+            }
+    }
+}
+
+static void makeAmplitudes (void)
+{
+    for (int k = 0; k < N/2; k++)
+        twiddle[k] = cexp (2 * M_PI * I * k / N);
+
+    amplitude = malloc (N * N * sizeof(double));
+    double df = 1.0 / N;
+    for (int y = 0; y < N; y++)
+        for (int x = 0; x < N; x++)
+        {
+            double fx = (x < N/2 ? x : x - N) * df;
+            double fy = (y < N/2 ? y : y - N) * df;
+            double f = sqrt (fx*fx + fy*fy);
+            // The piston bin is left out; the subharmonics cover low orders
+            amplitude[y*N + x] = (x || y) ? sqrt (phasePSD (f, r0, L0)) * df : 0;
+        }
+}
+
+/* Two screens in the real and imaginary parts of grid */
+static void makeScreens (double complex *grid, uint64_t *s)
+{
+    for (int i = 0; i < N * N; i++)
+        grid[i] = gaussian (s) * amplitude[i];
+    // Columns first, then only the rows that are shown
+    for (int x = 0; x < N; x++)
+        fft (&grid[x], N);
+    for (int y = 0; y < LCD_HEIGHT; y++)
+        fft (&grid[y*N], 1);
+
+    // Subharmonics: 3x3 grids of frequencies 1/3^p of the FFT spacing
+    for (int p = 1; p <= SUBHARMONICS; p++)
+    {
+        double df = 1.0 / (N * pow (3, p));
+        for (int j = -1; j <= 1; j++)
+            for (int i = -1; i <= 1; i++)
+            {
+                if (!i && !j)
+                    continue;
+                double fx = i * df, fy = j * df;
+                double complex c = gaussian (s) * sqrt (phasePSD (hypot (fx, fy), r0, L0)) * df;
+                for (int y = 0; y < LCD_HEIGHT; y++)
+                {
+                    double complex row = c * cexp (2 * M_PI * I * fy * y);
+                    double complex step = cexp (2 * M_PI * I * fx);
+                    for (int x = 0; x < LCD_WIDTH; x++, row *= step)
+                        grid[y*N + x] += row;
+                }
+            }
+    }
+}
+
+/* Wrap one screen (part 0 real, 1 imaginary) into a frame */
+static void quantise (const double complex *grid, int part, uint8 *frame, slot_t *slot)
+{
+    for (int y = 0; y < LCD_HEIGHT; y++)
+        for (int x = 0; x < LCD_WIDTH; x++)
+        {
+            double phase = part ? cimag (grid[y*N + x]) : creal (grid[y*N + x]);
+            int shade = (int)floor (phase * 32 / (2 * M_PI)) & 31;
+            frame[y*LCD_WIDTH + x] = shade << 3;
+        }
+
+    if (!check)
+        return;
+    for (int r = 1; r <= MAX_R; r++)
+        for (int y = 0; y < LCD_HEIGHT; y++)
+            for (int x = 0; x + r < LCD_WIDTH; x++)
+            {
+                const double complex *g = &grid[y*N + x];
+                double d = part ? cimag (g[r]) - cimag (g[0]) : creal (g[r]) - creal (g[0]);
+                slot->sf[r] += d * d;
+            }
+    slot->sfCount++;
+}
+
+static void *worker (void *arg)
+{
+    double complex *grid = malloc (N * N * sizeof(double complex));
+    long pairs = (frames + 1) / 2;
+    (void)arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock (&lock);
+        long pair = nextPair;
+        if (pair >= pairs)
+        {
+            pthread_mutex_unlock (&lock);
+            break;
+        }
+        nextPair++;
+        slot_t *slot = &slots[pair % nSlots];
+        while (slot->pair != -1)
+            pthread_cond_wait (&freed, &lock);
+        slot->pair = pair;
+        slot->ready = 0;
+        pthread_mutex_unlock (&lock);
+
+        uint64_t s = seed * 0x100000001B3ULL + pair;
+        nextRandom (&s);
+        makeScreens (grid, &s);
+        quantise (grid, 0, slot->frame[0], slot);
+        quantise (grid, 1, slot->frame[1], slot);
+
+        pthread_mutex_lock (&lock);
+        slot->ready = 1;
+        pthread_cond_broadcast (&done);
+        pthread_mutex_unlock (&lock);
+    }
+    free (grid);
+    return NULL;
+}
+
+int main (int argc, char **argv)
+{
+    int threads = sysconf (_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt (argc, argv, "n:r:L:s:j:c")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': frames = atol (optarg); break;
+            case 'r': r0 = atof (optarg); break;
+            case 'L': L0 = atof (optarg); break;
+            case 's': seed = strtoull (optarg, NULL, 0); break;
+            case 'j': threads = atoi (optarg); break;
+            case 'c': check = 1; break;
+            default:
+                fprintf (stderr, "usage: %s [-n frames] [-r r0] [-L L0] [-s seed] [-j threads] [-c] [output]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (threads < 1)
+        threads = 1;
+
+    FILE *out = stdout;
+    if (optind < argc && (out = fopen (argv[optind], "wb")) == NULL)
+    {
+        perror (argv[optind]);
+        return 1;
+    }
+
+    makeAmplitudes ();
+    nSlots = SLOTS_PER_THREAD * threads;
+    slots = calloc (nSlots, sizeof(slot_t));
+    for (int i = 0; i < nSlots; i++)
+        slots[i].pair = -1;
+
+    double start = now ();
+    pthread_t *pool = malloc (threads * sizeof(pthread_t));
+    for (int i = 0; i < threads; i++)
+        pthread_create (&pool[i], NULL, worker, NULL);
+
+    // Write the pairs out in order as they complete
+    double sf[MAX_R + 1] = { 0 };
+    long sfCount = 0;
+    long pairs = (frames + 1) / 2;
+    for (written = 0; written < pairs; written++)
+    {
+        slot_t *slot = &slots[written % nSlots];
+        pthread_mutex_lock (&lock);
+        while (slot->pair != written || !slot->ready)
+            pthread_cond_wait (&done, &lock);
+        pthread_mutex_unlock (&lock);
+
+        int n = (2*written + 1 < frames) ? 2 : 1;
+        if (fwrite (slot->frame, FRAME_BYTES, n, out) != (size_t)n)
+        {
+            perror ("write");
+            return 1;
+        }
+        for (int r = 1; r <= MAX_R; r++)
+            sf[r] += slot->sf[r];
+        sfCount += slot->sfCount;
+        memset (slot->sf, 0, sizeof(slot->sf));
+        slot->sfCount = 0;
+
+        pthread_mutex_lock (&lock);
+        slot->pair = -1;
+        pthread_cond_broadcast (&freed);
+        pthread_mutex_unlock (&lock);
+    }
+    for (int i = 0; i < threads; i++)
+        pthread_join (pool[i], NULL);
+    fflush (out);
+
+    double elapsed = now () - start;
+    fprintf (stderr, "%ld frames in %.3f s, %.1f frames/s on %d threads\n",
+            frames, elapsed, elapsed > 0 ? frames / elapsed : 0.0, threads);
+
+    if (check && sfCount)
+    {
+        fprintf (stderr, "\n   r   von Karman   screens   error\n");
+        for (int r = 1; r <= MAX_R; r++)
+        {
+            double theory = structureFunction (r, r0, L0);
+            double d = sf[r] / (sfCount * (double)LCD_HEIGHT * (LCD_WIDTH - r));
+            fprintf (stderr, "%4d %10.3f %10.3f %+7.1f%%\n", r, theory, d, 100 * (d / theory - 1));
+        }
+    }
+    return 0;
+}
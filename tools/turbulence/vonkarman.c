@@ -0,0 +1,46 @@
+/*
+ * vonkarman.c
+ *
+ * Von Karman phase statistics for the turbulence tools
+ *
+ * John Howe 2010
+ */
+
+#include <math.h>
+#include "vonkarman.h"
+
+/* Modified Bessel function of the second kind, from
+ * K_nu(x) = integral over t > 0 of exp(-x cosh t) cosh(nu t) */
+static double besselK (double nu, double x)
+{
+    const double dt = 1e-3;
+    double sum = 0.5 * exp (-x);
+    for (double t = dt; x * cosh (t) < 50; t += dt)
+        sum += exp (-x * cosh (t)) * cosh (nu * t);
+    return sum * dt;
+}
+
+double phaseCovariance (double r, double r0, double L0)
+{
+    double c = pow (L0 / r0, 5.0/3) * pow (2, -5.0/6) * tgamma (11.0/6) /
+            pow (M_PI, 8.0/3) * pow (24.0/5 * tgamma (6.0/5), 5.0/6);
+    double x = 2 * M_PI * r / L0;
+    if (x < 1e-9)
+        return c * pow (2, -1.0/6) * tgamma (5.0/6); // limit of x^(5/6) K(x)
+    return c * pow (x, 5.0/6) * besselK (5.0/6, x);
+}
+
+double structureFunction (double r, double r0, double L0)
+{
+    return 2 * (phaseCovariance (0, r0, L0) - phaseCovariance (r, r0, L0));
+}
+
+double phasePSD (double f, double r0, double L0)
+{
+    return 0.023 * pow (r0, -5.0/3) * pow (f * f + 1 / (L0 * L0), -11.0/6);
+}
+
+double kolmogorov (double r, double r0)
+{
+    return 6.88 * pow (r / r0, 5.0/3);
+}
@@ -0,0 +1,26 @@
+/*
+ * vonkarman.h
+ *
+ * Von Karman phase statistics for the turbulence tools
+ *
+ * John Howe 2010
+ */
+
+#ifndef VONKARMAN_H
+#define VONKARMAN_H
+
+/* Phase covariance in rad^2 between points r apart, for Fried parameter r0
+ * and outer scale L0 (all in the same units) */
+double phaseCovariance (double r, double r0, double L0);
+
+/* Phase structure function, 2 (C(0) - C(r)), in rad^2 */
+double structureFunction (double r, double r0, double L0);
+
+/* Von Karman phase power spectral density in rad^2 per (cycle/unit)^2 at
+ * spatial frequency f (cycles/unit) */
+double phasePSD (double f, double r0, double L0);
+
+/* Kolmogorov structure function 6.88 (r/r0)^(5/3), the L0 -> infinity limit */
+double kolmogorov (double r, double r0);
+
+#endif